@@ -3,24 +3,47 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <render/shader.h>
+#include "shader.h"
+#include "scenewindow.h"
+#include "flycamera.h"
+#include "chunkstreamer.h"
+#include "noise.h"
+#include "threadpool.h"
+#include "textureloader.h"
+#include "assetpack.h"
+#include "profiler.h"
+#include "benchmark.h"
+#include "inputlog.h"
+#include "simulation.h"
+#include "spatialgrid.h"
+#include "glresource.h"
+#include "streambuffer.h"
+#include "occlusionculler.h"
+#include "shadowcascades.h"
+#include "skybox.h"
+#include "tilerenderer.h"
+#include "boxrenderer.h"
 #include <vector>
 #include <iostream>
 #include <string>
 #include <tuple>
 #include <unordered_set>
-
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <stb/stb_image.h>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <cstddef>
+#include <cstring>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <iomanip>
 #include <sstream> 
 
-void handleCameraMovement(GLFWwindow* window);
+void handleCameraMovement(double tickSeconds);
+glm::vec3 collideCamera(glm::vec3 start, glm::vec3 end);
+void followCameraPath(const CameraPath& path, double time);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+void applyMouseMovement(double xpos, double ypos);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 static GLFWwindow *window;
@@ -28,749 +51,882 @@ static int windowWidth = 1024;
 static int windowHeight = 768;
 
 // Camera variables
-static glm::vec3 cameraPos(5.0f, 5.0f, 5.0f);
-static glm::vec3 cameraFront(0.0f, -1.0f, 0.0f);
-static glm::vec3 cameraUp(0.0f, 1.0f, 0.0f);
-static float yaw = -90.0f;
-static float pitch = 0.0f;
-static float lastX = windowWidth / 2.0f;
-static float lastY = windowHeight / 2.0f;
-static bool firstMouse = true;
-static float cameraSpeed = 0.05f;
+static FlyCamera flyCamera(glm::vec3(5.0f, 5.0f, 5.0f), glm::vec3(0.0f, -1.0f, 0.0f), -90.0f, 0.0f,
+    3.0f);	// Speed in units per second, each tick moves it by speed times the tick length
+
+// The world advances in fixed steps, see simulation.h
+static const double simulationTickSeconds = 1.0 / 120.0;
+
+// Every key and cursor event passes through here, so a session can be recorded and replayed
+static InputLog input;
 
 // grid parameters
 static const float cellSize = 10.0f;
-static const int renderDistance = 5;
-
-static GLuint LoadTexture(const char *texture_file_path) {
-    int w, h, channels;
-    uint8_t* img = stbi_load(texture_file_path, &w, &h, &channels, 3);
-    GLuint texture;
-    glGenTextures(1, &texture);  
-    glBindTexture(GL_TEXTURE_2D, texture);  
-
-    // To tile textures on a box, we set wrapping to repeat
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);     // Set pixel storage mode to ensure correct alignment
-
-    if (img) {
-		std::cout << "Texture loaded: " << texture_file_path << std::endl;
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, img);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    } else {
-        std::cout << "Failed to load texture " << texture_file_path << std::endl;
-    }
-	
-    stbi_image_free(img);
+static int renderDistance = 5;     // In cells, set from the view distance at startup
 
-    return texture;
+// Textures are decoded on worker threads and staged through a PBO, see textureloader.h
+static const double textureUploadBudget = 0.002;   // Seconds per frame spent staging texture data
+
+// Per-frame uniforms streamed once and shared by the tile and building programs,
+// laid out as the std140 FrameData block in their vertex shaders
+struct FrameData {
+    glm::mat4 viewProjection;
+    glm::vec4 eye;          // Camera position, w unused
+    glm::vec4 lodRange;     // Distances over which building meshes fade out and impostors fade in
+};
+static const GLuint frameDataBinding = 0;
+
+// The sun, lighting every lit program and casting shadows from the buildings. Its cascades
+// go to the ShadowData block and the shadowMap sampler of their fragment shaders.
+static const glm::vec3 towardsSun = glm::vec3(50.0f, 80.0f, 50.0f);   // Normalised by ShadowCascades
+static const glm::vec3 sunColor = glm::vec3(1.0f, 1.0f, 0.8f);        // light yellow light
+static const GLuint shadowDataBinding = 1;
+static const GLint shadowTextureUnit = 2;
+ShadowCascades shadowCascades;
+
+// Point a lit program at the shadow cascades
+static void bindShadowInputs(GLuint program) {
+    glUniformBlockBinding(program, glGetUniformBlockIndex(program, "ShadowData"), shadowDataBinding);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "shadowMap"), shadowTextureUnit);
+    glUseProgram(0);
 }
 
-// Global variables
-GLuint tileProgramID;
-GLuint buildingProgramID;
-GLuint skyboxProgramID;
+// Every building has the same footprint, only its height and facade vary
+static const float buildingHalfWidth = 2.5f;
+static const float minBuildingHeight = 5.0f;
+static const int buildingHeightSteps = 15;
 
-struct Skybox {
+// A generated building as it leaves a worker, before it joins the BuildingStore
+struct Building {
 	glm::vec3 position;		// Position of the box 
 	glm::vec3 scale;		// Size of the box in each axis
-	
-	GLfloat vertex_buffer_data[72] = {	// Vertex definition for a canonical box
-		// Front face
-		-1.0f, -1.0f, 1.0f, 
-		1.0f, -1.0f, 1.0f, 
-		1.0f, 1.0f, 1.0f, 
-		-1.0f, 1.0f, 1.0f, 
-		
-		// Back face 
-		1.0f, -1.0f, -1.0f, 
-		-1.0f, -1.0f, -1.0f, 
-		-1.0f, 1.0f, -1.0f, 
-		1.0f, 1.0f, -1.0f,
-		
-		// Left face
-		-1.0f, -1.0f, -1.0f, 
-		-1.0f, -1.0f, 1.0f, 
-		-1.0f, 1.0f, 1.0f, 
-		-1.0f, 1.0f, -1.0f, 
-
-		// Right face 
-		1.0f, -1.0f, 1.0f, 
-		1.0f, -1.0f, -1.0f, 
-		1.0f, 1.0f, -1.0f, 
-		1.0f, 1.0f, 1.0f,
-
-		// Top face
-		-1.0f, 1.0f, 1.0f, 
-		1.0f, 1.0f, 1.0f, 
-		1.0f, 1.0f, -1.0f, 
-		-1.0f, 1.0f, -1.0f, 
-
-		// Bottom face
-		-1.0f, -1.0f, -1.0f, 
-		1.0f, -1.0f, -1.0f, 
-		1.0f, -1.0f, 1.0f, 
-		-1.0f, -1.0f, 1.0f, 
-	};
-
-	GLfloat color_buffer_data[72] = {
-		// Front, red
-		1.0f, 0.0f, 0.0f,
-		1.0f, 0.0f, 0.0f,
-		1.0f, 0.0f, 0.0f,
-		1.0f, 0.0f, 0.0f,
-
-		// Back, yellow
-		1.0f, 1.0f, 0.0f,
-		1.0f, 1.0f, 0.0f,
-		1.0f, 1.0f, 0.0f,
-		1.0f, 1.0f, 0.0f,
-
-		// Left, green
-		0.0f, 1.0f, 0.0f, 
-		0.0f, 1.0f, 0.0f,
-		0.0f, 1.0f, 0.0f,
-		0.0f, 1.0f, 0.0f,
-
-		// Right, cyan
-		0.0f, 1.0f, 1.0f, 
-		0.0f, 1.0f, 1.0f, 
-		0.0f, 1.0f, 1.0f, 
-		0.0f, 1.0f, 1.0f, 
-
-		// Top, blue
-		0.0f, 0.0f, 1.0f, 
-		0.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, 1.0f,
-
-		// Bottom, magenta
-		1.0f, 0.0f, 1.0f,
-		1.0f, 0.0f, 1.0f, 
-		1.0f, 0.0f, 1.0f, 
-		1.0f, 0.0f, 1.0f,  
-	};
-
-    
-	// Modify the cube buffers so that the inner surfaces of the cube becomes front facing in counter-clockwise order.
-	// to position viewer inside the cube need to render inner faces
-    // reverse winding order, front face of each triangle is on inside of cube 
-	GLuint index_buffer_data[36] = {		
-        0, 3, 2,
-		0, 2, 1,
-
-		4, 7, 6,
-		4, 6, 5,
-
-		8, 11, 10,
-		8, 10, 9,
-
-		12, 15, 14,
-		12, 14, 13,
-
-		16, 19, 18,
-		16, 18, 17,
-
-		20, 23, 22,
-		20, 22, 21,
- 
-	};
-
-	GLfloat uv_buffer_data[48] = {
-		// Pos Z
-		0.5f, 0.666f,  	// Top right
-		0.25f, 0.666f, 	// Top left
-		0.25f, 0.333f, 	// Bottom left
-		0.5f, 0.333f,  	// Bottom right
-
-		// Neg Z
-		1.0f, 0.666f,  	// Top right
-		0.75f, 0.666f, 	// Top left
-		0.75f, 0.333f, 	// Bottom left
-		1.0f, 0.333f,  	// Bottom right
-
-		// Pos X
-		0.75f, 0.666f, 	// Top right
-		0.5f, 0.666f,  	// Top left
-		0.5f, 0.333f,  	// Bottom left
-		0.75f, 0.333f, 	// Bottom right
-
-		// Neg X
-		0.25f, 0.666f, 	// Top right
-		0.0f, 0.666f,  	// Top left
-		0.0f, 0.333f,  	// Bottom left
-		0.25f, 0.333f, 	// Bottom right
-
-		// Neg Y
-		0.5f, 0.333f,  	// Top right
-		0.25f, 0.333f,  // Top left
-		0.25f, 0.0f,   	// Bottom left
-		0.5f, 0.0f,    	// Bottom right
-
-        // Pos Y
-		0.5f, 1.0f,    	// Top right
-		0.25f, 1.0f,   	// Top left
-		0.25f, 0.666f, 	// Bottom left
-		0.5f, 0.666f  	// Bottom right
-
-	};
-    
-	// OpenGL buffers
-	GLuint vertexArrayID; 
-	GLuint vertexBufferID; 
-	GLuint indexBufferID; 
-	GLuint colorBufferID;
-	GLuint uvBufferID;
-	GLuint textureID;
-
-	// Shader variable IDs
-	GLuint mvpMatrixID;
-	GLuint textureSamplerID;
-	
-
-	void initialize(glm::vec3 position, glm::vec3 scale) {
-		// Define scale of the skybox geometry
-		this->position = position;
-		this->scale = scale;
-
-		// Create a vertex array object
-		glGenVertexArrays(1, &vertexArrayID);
-		glBindVertexArray(vertexArrayID);
-
-		// Create a vertex buffer object to store the vertex data		
-		glGenBuffers(1, &vertexBufferID);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertex_buffer_data), vertex_buffer_data, GL_STATIC_DRAW);
-
-		// Create a vertex buffer object to store the color data
-        for (int i = 0; i < 72; ++i) {
-        	color_buffer_data[i] = 1.0f; 
-    	}
-		glGenBuffers(1, &colorBufferID);
-		glBindBuffer(GL_ARRAY_BUFFER, colorBufferID);		
-		glBufferData(GL_ARRAY_BUFFER, sizeof(color_buffer_data), color_buffer_data, GL_STATIC_DRAW);
-
-
-		// create a uv buffer object to store the uv data 
-		glGenBuffers(1, &uvBufferID);
-		glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(uv_buffer_data), uv_buffer_data, GL_STATIC_DRAW);
-
-		// Create an index buffer object to store the index data that defines triangle faces
-		glGenBuffers(1, &indexBufferID);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(index_buffer_data), index_buffer_data, GL_STATIC_DRAW);
-
-		// Create and compile our GLSL program from the shaders
-		skyboxProgramID = LoadShadersFromFile("../FinalProject/skybox.vert", "../FinalProject/skybox.frag");
-		if (skyboxProgramID == 0)
-		{
-			std::cerr << "Failed to load shaders." << std::endl;
-		}
-
-		// Get a handle for our "MVP" uniform
-		mvpMatrixID = glGetUniformLocation(skyboxProgramID, "MVP");
-		textureID = LoadTexture("../FinalProject/sky3.png");
-		textureSamplerID = glGetUniformLocation(skyboxProgramID,"textureSampler");
-	}
-
-	void render(glm::mat4 cameraMatrix) {
-		glUseProgram(skyboxProgramID);
-
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, colorBufferID);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-
-		// Model transform 
-
-    	glm::mat4 modelMatrix = glm::mat4();
-    	modelMatrix = glm::scale(modelMatrix, scale);
-
-		// Set model-view-projection matrix
-		glm::mat4 mvp = cameraMatrix * modelMatrix;
-		glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);  //sends mvp matrix to vertex shader
-
-		// Enable UV buffer and texture sampler
-		glEnableVertexAttribArray(2);
- 		glBindBuffer(GL_ARRAY_BUFFER, uvBufferID);
- 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-		 // Set textureSampler to use texture unit 0
-		glActiveTexture(GL_TEXTURE0);
- 		glBindTexture(GL_TEXTURE_2D, textureID);
- 		glUniform1i(textureSamplerID, 0); 
-	
-		// Draw the box
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			36,    			   // number of indices
-			GL_UNSIGNED_INT,   // type
-			(void*)0           // element array buffer offset
-		);
-
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-        //glDisableVertexAttribArray(2);
-	}
-
-	void cleanup() {
-		glDeleteBuffers(1, &vertexBufferID);
-		glDeleteBuffers(1, &colorBufferID);
-		glDeleteBuffers(1, &indexBufferID);
-		glDeleteVertexArrays(1, &vertexArrayID);
-		glDeleteBuffers(1, &uvBufferID);
-		glDeleteTextures(1, &textureID);
-		glDeleteProgram(skyboxProgramID);
-	}
+    int facade;             // Index into BuildingFacades
+
+    // Constructor
+    Building(glm::vec3 position, glm::vec3 scale, int facade)
+        : position(position), scale(scale), facade(facade) {}
 };
 
-struct Tile {
-    float tileVertices[20] = {
-        // pos               // uv
-        -0.5f, 0.0f, -0.5f,  0.0f, 0.0f,
-         0.5f, 0.0f, -0.5f,  1.0f, 0.0f,
-         0.5f, 0.0f,  0.5f,  1.0f, 1.0f,
-        -0.5f, 0.0f,  0.5f,  0.0f, 1.0f
-    };
+// Every building placed so far, one array per field. Collision and culling read only the
+// fields they need, packed back to back. A building costs 30 bytes here, plus its grid entry.
+struct BuildingStore {
+    std::vector<glm::vec3> positions;       // Box centres
+    std::vector<glm::vec3> halfExtents;     // Same scale the instance attribute draws with
+    std::vector<uint16_t> facades;          // Index into BuildingFacades, which is also the batch
+    std::vector<uint32_t> instanceSlots;    // Instance index within the facade's batch
+
+    size_t size() const { return positions.size(); }
+
+    uint32_t add(const Building& building, uint32_t instanceSlot) {
+        positions.push_back(building.position);
+        halfExtents.push_back(building.scale);
+        facades.push_back((uint16_t)building.facade);
+        instanceSlots.push_back(instanceSlot);
+        return (uint32_t)positions.size() - 1;
+    }
+};
 
-    float tileNormals[12] = {
-        0.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f
-    };
+// Vertex of a baked chunk mesh, matches building_baked.vert. Positions are already in world
+// space and layer picks the facade in the facade array texture.
+struct BakedVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+    float layer;
+};
+
+// Every building of a chunk merged into one mesh, built on the worker that placed them
+struct ChunkMesh {
+    std::vector<BakedVertex> vertices;
+    std::vector<GLushort> indices;
+};
 
-    unsigned int tileIndices[6] = {
-        0, 1, 2,
-        0, 2, 3
+// Buildings of one generated chunk, drawn and occlusion tested together. A chunk's buildings
+// are appended to each facade batch in one go, so they are a contiguous run of its instances.
+struct BuildingBlock {
+    struct Range {
+        int batch;
+        int first;
+        int count;
     };
+    std::vector<Range> ranges;  // One per facade the chunk uses
+    glm::vec3 center;           // Bounds of all the chunk's buildings
+    glm::vec3 halfExtents;
+    GLQuery query;              // GL_ANY_SAMPLES_PASSED on the bounds, issued after the frame's opaque draws
+
+    // The chunk's baked mesh, drawn in one call once the facade array exists
+    GLVertexArray meshArray;
+    GLBuffer meshVertices;
+    GLBuffer meshIndices;
+    int meshIndexCount = 0;
+
+    bool queried = false;       // The query was issued last frame and can gate this frame's draw
+    bool inView = false;
+    bool aroundEye = false;     // The camera is within a unit of the bounds, set with inView
+};
 
-    GLuint vertexArrayID;
-    GLuint vertexBufferID;
-    GLuint normalBufferID;
-    GLuint indexBufferID;
-    
-    // shader buffers
-    GLuint textureID;
-    GLuint mvpMatrixID;
-    GLuint modelMatrixID; 
-    GLuint lightPosID;
-    GLuint lightColorID;
+// Depth only pass of the buildings into a shadow cascade
+static const char *shadowCasterVertexShader = R"(
+#version 330 core
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 4) in vec3 instancePosition;
+layout(location = 5) in vec3 instanceScale;
 
-    glm::vec3 position;
-    float scale;
-
-    //constructor
-    Tile(glm::vec3 pos, float size) : position(pos), scale(size) {}
-
-    void initialize(const std::string& textureFilePath) {
-        // Generate and bind a Vertex Array Object (VAO) to manage vertex attributes.
-        glGenVertexArrays(1, &vertexArrayID);
-        glBindVertexArray(vertexArrayID);
-
-        // Generate and bind a Vertex Buffer Object (VBO) for storing vertex data.
-        glGenBuffers(1, &vertexBufferID);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(tileVertices), tileVertices, GL_STATIC_DRAW);
-
-        // Generate and bind a buffer for storing normal vectors.
-        glGenBuffers(1, &normalBufferID);
-        glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(tileNormals), tileNormals, GL_STATIC_DRAW);
-
-        // Generate and bind an Element Buffer Object (EBO) for storing indices.
-        glGenBuffers(1, &indexBufferID);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(tileIndices), tileIndices, GL_STATIC_DRAW);
-
-        // Load the vertex and fragment shaders for the tile program.
-        tileProgramID = LoadShadersFromFile("../FinalProject/tile.vert", "../FinalProject/tile.frag");
-		if (tileProgramID == 0)
-		{
-			std::cerr << "Failed to load shaders." << std::endl;
-		}
-
-        // Load the texture from the specified file path.
-        textureID = LoadTexture(textureFilePath.c_str());
-
-        // retrieving uniform locations for shader variables from the shader program tileProgramID
-        mvpMatrixID = glGetUniformLocation(tileProgramID, "MVP");
-        modelMatrixID = glGetUniformLocation(tileProgramID, "model");
-        lightPosID = glGetUniformLocation(tileProgramID, "lightPos");
-        lightColorID = glGetUniformLocation(tileProgramID, "lightColor");
+uniform mat4 lightViewProjection;
+
+void main() {
+    gl_Position = lightViewProjection * vec4(instancePosition + vertexPosition * instanceScale, 1.0);
+}
+)";
+
+static const char *shadowCasterFragmentShader = R"(
+#version 330 core
+void main() {
+}
+)";
+
+// Vertex shader of the block bounds drawn for occlusion queries; writes no colour or depth
+static const char *blockBoundsVertexShader = R"(
+#version 330 core
+layout(location = 0) in vec3 vertexPosition;
+
+layout(std140) uniform FrameData {
+    mat4 VP;
+};
+
+uniform vec3 center;
+uniform vec3 halfExtents;
+
+void main() {
+    gl_Position = VP * vec4(center + vertexPosition * halfExtents, 1.0);
+}
+)";
+
+static const char *blockBoundsFragmentShader = R"(
+#version 330 core
+out vec4 finalColor;
+
+void main() {
+    finalColor = vec4(1.0);
+}
+)";
+
+// False only if the box is entirely outside one plane of the view frustum
+static bool boxInFrustum(const glm::mat4& vp, const glm::vec3& center, const glm::vec3& halfExtents) {
+    int outside[6] = {};
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 corner = center + halfExtents * glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+        glm::vec4 clip = vp * glm::vec4(corner, 1.0f);
+        outside[0] += clip.x < -clip.w;
+        outside[1] += clip.x > clip.w;
+        outside[2] += clip.y < -clip.w;
+        outside[3] += clip.y > clip.w;
+        outside[4] += clip.z < -clip.w;
+        outside[5] += clip.z > clip.w;
+    }
+    for (int plane = 0; plane < 6; ++plane) {
+        if (outside[plane] == 8)
+            return false;
     }
+    return true;
+}
 
-    void render(glm::mat4 viewProjection) {
-        // shader program for rendering
-        glUseProgram(tileProgramID);
+struct BuildingRenderer {
+    // The building boxes, one batch per facade
+    BoxRenderer boxes;
+    std::vector<std::vector<BoxInstance>> visibleRecords;  // Staging for renderVisible, one per facade
+
+    GLProgram shadowProgram;
+    GLint shadowMatrixID;
+
+    // Per-chunk blocks for GPU occlusion queries, and the program drawing their bounds
+    std::vector<BuildingBlock> blocks;
+    GLProgram boundsProgram;
+    GLVertexArray boundsVAO;
+    GLint boundsCenterID;
+    GLint boundsHalfExtentsID;
+    static constexpr float queryProxyMargin = 0.05f;   // World units the query boxes are grown by
+
+    // Every facade copied into one array texture, so a baked chunk needs a single draw
+    GLTexture facadeArray;
+    GLProgram bakedProgram;
+    GLuint bakedLightColorID;
+    static const int facadeArraySize = 512;
+
+    // Block counts of the last renderQueried() frame
+    int blockDraws = 0;
+    int blocksInView = 0;
+    int blocksSkipped = 0;        // Hidden in the last query result the GPU had ready
+    int blocksUnconditional = 0;  // Drawn without a query to gate them
+
+    // Blocks drawn into shadow cascades so far, across every cascade render
+    unsigned long casterBlocksDrawn = 0;
 
-        // Bind the Vertex Array Object (VAO) for the tile.
-        glBindVertexArray(vertexArrayID);
+    // Initialization function
+    void initialize(const std::vector<std::string>& facadeFiles) {
+        // Each facade texture is loaded once and shared by all its buildings, repeated 5 times up the walls
+        boxes.initialize("../FinalProject/building.vert", "../FinalProject/building.frag", facadeFiles, 5.0f);
+        GLuint buildingProgram = boxes.programID();
+        glUniformBlockBinding(buildingProgram, glGetUniformBlockIndex(buildingProgram, "FrameData"), frameDataBinding);
+        bindShadowInputs(buildingProgram);
+        glUseProgram(buildingProgram);
+        glUniform3fv(glGetUniformLocation(buildingProgram, "lightColor"), 1, &sunColor[0]);
+        glUseProgram(0);
 
-        // Create the model matrix
-        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
-        model = glm::scale(model, glm::vec3(scale));
-        glUniformMatrix4fv(modelMatrixID, 1, GL_FALSE, &model[0][0]);
+        boundsProgram = GLProgram(LoadShadersFromString(blockBoundsVertexShader, blockBoundsFragmentShader));
+        if (!boundsProgram) {
+            std::cerr << "Failed to load block bounds shaders." << std::endl;
+        }
+        glUniformBlockBinding(boundsProgram.get(), glGetUniformBlockIndex(boundsProgram.get(), "FrameData"), frameDataBinding);
+        boundsCenterID = glGetUniformLocation(boundsProgram.get(), "center");
+        boundsHalfExtentsID = glGetUniformLocation(boundsProgram.get(), "halfExtents");
 
-        // Compute and pass the mvp matrix to the shader
-        glm::mat4 mvp = viewProjection * model;
-        glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
+        bakedProgram = GLProgram(LoadShadersFromFile("../FinalProject/building_baked.vert", "../FinalProject/building_baked.frag"));
+        if (!bakedProgram) {
+            std::cerr << "Failed to load baked building shaders." << std::endl;
+        }
+        glUniformBlockBinding(bakedProgram.get(), glGetUniformBlockIndex(bakedProgram.get(), "FrameData"), frameDataBinding);
+        bindShadowInputs(bakedProgram.get());
+        bakedLightColorID = glGetUniformLocation(bakedProgram.get(), "lightColor");
+        glUseProgram(bakedProgram.get());
+        glUniform1i(glGetUniformLocation(bakedProgram.get(), "facades"), 0);
+        glUseProgram(0);
 
-        // Set the light position and color uniforms in the shader
-        glm::vec3 lightPosition = glm::vec3(50.0f, 80.0f, 50.0f);
-        glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 0.8f); // light yellow light
-        glUniform3fv(lightPosID, 1, &lightPosition[0]);
-        glUniform3fv(lightColorID, 1, &lightColor[0]);
+        shadowProgram = GLProgram(LoadShadersFromString(shadowCasterVertexShader, shadowCasterFragmentShader));
+        if (!shadowProgram) {
+            std::cerr << "Failed to load shadow caster shaders." << std::endl;
+        }
+        shadowMatrixID = glGetUniformLocation(shadowProgram.get(), "lightViewProjection");
 
-        // Positions
+        // The canonical box, positions only
+        boundsVAO = GLVertexArray::create();
+        glBindVertexArray(boundsVAO.get());
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, boxes.vertexBuffer());
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, boxes.indexBuffer());
+        glBindVertexArray(0);
+    }
+
+    // Append a chunk's buildings, one glBufferSubData per facade touched, and make them a block
+    // that keeps the chunk's baked mesh, if it was baked. slots receives the instance index each building got
+    // within its facade's batch.
+    void append(const std::vector<Building>& newBuildings, const ChunkMesh& mesh, std::vector<uint32_t>& slots) {
+        if (!newBuildings.empty()) {
+            addBlock(newBuildings);
+            uploadMesh(blocks.back(), mesh);
+        }
+
+        std::vector<std::vector<BoxInstance>> records(boxes.batches.size());
+        slots.clear();
+        for (const Building& building : newBuildings) {
+            slots.push_back(boxes.batches[building.facade].instanceCount + (uint32_t)records[building.facade].size());
+            records[building.facade].push_back({ building.position, building.scale });
+        }
 
-        // UVs
+        for (size_t i = 0; i < records.size(); ++i)
+            boxes.append((int)i, records[i].data(), (int)records[i].size());
+    }
+
+    // Record where the chunk's instances will land in each batch, before they are appended
+    void addBlock(const std::vector<Building>& newBuildings) {
+        BuildingBlock block;
+        glm::vec3 low(1e30f), high(-1e30f);
+        std::vector<int> counts(boxes.batches.size(), 0);
+        for (const Building& building : newBuildings) {
+            low = glm::min(low, building.position - building.scale);
+            high = glm::max(high, building.position + building.scale);
+            counts[building.facade]++;
+        }
+        for (size_t i = 0; i < boxes.batches.size(); ++i) {
+            if (counts[i] > 0)
+                block.ranges.push_back({ (int)i, boxes.batches[i].instanceCount, counts[i] });
+        }
+        block.center = (low + high) * 0.5f;
+        block.halfExtents = (high - low) * 0.5f;
+        block.query = GLQuery::create();
+        blocks.push_back(std::move(block));
+    }
+
+    void uploadMesh(BuildingBlock& block, const ChunkMesh& mesh) {
+        if (mesh.indices.empty())
+            return;
+
+        block.meshArray = GLVertexArray::create();
+        glBindVertexArray(block.meshArray.get());
+
+        block.meshVertices = GLBuffer::create();
+        glBindBuffer(GL_ARRAY_BUFFER, block.meshVertices.get());
+        glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(BakedVertex), mesh.vertices.data(), GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BakedVertex), (void*)offsetof(BakedVertex, position));
         glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-
-        // Normals
-        glEnableVertexAttribArray(2); 
-        glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
-       
-       // Binding the texture to texture unit 0 and passing it to shader.
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(BakedVertex), (void*)offsetof(BakedVertex, normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(BakedVertex), (void*)offsetof(BakedVertex, uv));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(BakedVertex), (void*)offsetof(BakedVertex, layer));
+
+        block.meshIndices = GLBuffer::create();
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.meshIndices.get());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLushort), mesh.indices.data(), GL_STATIC_DRAW);
+        block.meshIndexCount = (int)mesh.indices.size();
+
+        glBindVertexArray(0);
+    }
+
+    // Copy every facade texture into one layer of facadeArray, resampled to a common size.
+    // The facade textures must have finished loading.
+    void buildFacadeArray() {
+        static const char *copyVertexShader = R"(
+#version 330 core
+out vec2 uv;
+
+void main() {
+    // One triangle covering the viewport
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    uv = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+        static const char *copyFragmentShader = R"(
+#version 330 core
+in vec2 uv;
+uniform sampler2D source;
+out vec4 finalColor;
+
+void main() {
+    finalColor = texture(source, uv);
+}
+)";
+
+        facadeArray = GLTexture::create();
+        glBindTexture(GL_TEXTURE_2D_ARRAY, facadeArray.get());
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, facadeArraySize, facadeArraySize, (GLsizei)boxes.batches.size(),
+            0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+        // Drawn rather than blitted, so compressed facades copy too
+        GLProgram copyProgram(LoadShadersFromString(copyVertexShader, copyFragmentShader));
+        glUseProgram(copyProgram.get());
+        glUniform1i(glGetUniformLocation(copyProgram.get(), "source"), 0);
+        GLVertexArray emptyArray = GLVertexArray::create();
+        glBindVertexArray(emptyArray.get());
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLFramebuffer framebuffer = GLFramebuffer::create();
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+        glViewport(0, 0, facadeArraySize, facadeArraySize);
+        glDisable(GL_DEPTH_TEST);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glUniform1i(glGetUniformLocation(tileProgramID, "texture1"), 0);
 
-        // Render the tile using indexed drawing with triangles
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        for (size_t i = 0; i < boxes.batches.size(); ++i) {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, facadeArray.get(), 0, (GLint)i);
+            glBindTexture(GL_TEXTURE_2D, boxes.batches[i].texture);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+
+        glEnable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glBindVertexArray(0);
+        glUseProgram(0);
+
+        glBindTexture(GL_TEXTURE_2D_ARRAY, facadeArray.get());
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    // Baked blocks are one draw, the rest fall back to a draw per facade range
+    void drawBlock(const BuildingBlock& block, bool baked) {
+        if (baked && block.meshIndexCount > 0) {
+            glBindVertexArray(block.meshArray.get());
+            glDrawElements(GL_TRIANGLES, block.meshIndexCount, GL_UNSIGNED_SHORT, (void*)0);
+            blockDraws++;
+            return;
+        }
+
+        for (const BuildingBlock::Range& range : block.ranges) {
+            boxes.draw(range.batch, boxes.batches[range.batch].instanceBuffer.get(), range.first * sizeof(BoxInstance), range.count);
+            blockDraws++;
+        }
+    }
+
+    // Draw the blocks in view, each gated by its bounds query from the previous frame, then query
+    // every block's bounds against this frame's depth for the next. Nothing waits on a result: a
+    // query the GPU has not answered yet lets its block draw. Blocks without a query from the
+    // previous frame (new, just back in view, or around the camera) draw unconditionally, so
+    // anything revealed shows up at most one frame late.
+    // Once buildFacadeArray() has run, each block is its baked chunk mesh in a single draw.
+    // Call after the other opaque geometry; FrameData must already be bound to frameDataBinding.
+    void renderQueried(const glm::mat4& vp, const glm::vec3& eye) {
+        bool baked = (bool)facadeArray;
+        if (baked) {
+            glUseProgram(bakedProgram.get());
+            glUniform3fv(bakedLightColorID, 1, &sunColor[0]);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, facadeArray.get());
+        } else {
+            boxes.beginRender(vp);
+        }
+        blockDraws = 0;
+        blocksInView = 0;
+        blocksSkipped = 0;
+        blocksUnconditional = 0;
+
+        for (BuildingBlock& block : blocks) {
+            block.inView = boxInFrustum(vp, block.center, block.halfExtents);
+            if (!block.inView) {
+                block.queried = false;
+                continue;
+            }
+            blocksInView++;
+
+            // Boxes around the camera are clipped by the near plane and cannot be trusted
+            glm::vec3 offset = glm::abs(eye - block.center) - block.halfExtents;
+            block.aroundEye = std::max(offset.x, std::max(offset.y, offset.z)) < 1.0f;
+            if (block.aroundEye)
+                block.queried = false;
+
+            if (!block.queried) {
+                blocksUnconditional++;
+                drawBlock(block, baked);
+                continue;
+            }
+
+            // Only for the stats, the draw below never waits for it
+            GLuint available = 0;
+            glGetQueryObjectuiv(block.query.get(), GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint passed = 0;
+                glGetQueryObjectuiv(block.query.get(), GL_QUERY_RESULT, &passed);
+                blocksSkipped += passed == 0;
+            }
+
+            glBeginConditionalRender(block.query.get(), GL_QUERY_NO_WAIT);
+            drawBlock(block, baked);
+            glEndConditionalRender();
+        }
+
+        glUseProgram(boundsProgram.get());
+        glBindVertexArray(boundsVAO.get());
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+
+        for (BuildingBlock& block : blocks) {
+            if (!block.inView || block.aroundEye)
+                continue;
+
+            // Pushed out past the walls, which fill the same depths and would fail GL_LESS
+            glm::vec3 proxyHalfExtents = block.halfExtents + glm::vec3(queryProxyMargin);
+            glUniform3fv(boundsCenterID, 1, &block.center[0]);
+            glUniform3fv(boundsHalfExtentsID, 1, &proxyHalfExtents[0]);
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, block.query.get());
+            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (void*)0);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            block.queried = true;
+        }
+
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glBindVertexArray(0);
+    }
+
+    // Draw every building placed so far. FrameData must already be bound to frameDataBinding.
+    void render(const glm::mat4& vp) {
+        boxes.render(vp);
+    }
+
+    // Draw the depth of the blocks inside the bound shadow cascade. The cascade's volume already
+    // reaches towards the light, so its frustum keeps every block that can shade the square.
+    void renderShadowCasters(const glm::mat4& lightViewProjection) {
+        glUseProgram(shadowProgram.get());
+        glUniformMatrix4fv(shadowMatrixID, 1, GL_FALSE, &lightViewProjection[0][0]);
+
+        for (const BuildingBlock& block : blocks) {
+            if (!boxInFrustum(lightViewProjection, block.center, block.halfExtents))
+                continue;
+            casterBlocksDrawn++;
+
+            for (const BuildingBlock::Range& range : block.ranges)
+                boxes.draw(range.batch, boxes.batches[range.batch].instanceBuffer.get(), range.first * sizeof(BoxInstance), range.count);
+        }
 
-        // unbind vao
         glBindVertexArray(0);
+        glUseProgram(0);
+    }
+
+    // Draw only the given buildings, their records written to this frame's stream region.
+    // FrameData must already be bound to frameDataBinding.
+    void renderVisible(const std::vector<uint32_t>& visible, const BuildingStore& store, StreamBuffer& stream, const glm::mat4& vp) {
+        visibleRecords.resize(boxes.batches.size());
+        for (std::vector<BoxInstance>& records : visibleRecords)
+            records.clear();
+        for (uint32_t index : visible)
+            visibleRecords[store.facades[index]].push_back({ store.positions[index], store.halfExtents[index] });
+
+        boxes.render(visibleRecords, stream, vp);
     }
 
     void cleanup() {
-        glDeleteBuffers(1, &vertexBufferID);
-        glDeleteBuffers(1, &indexBufferID);
-        glDeleteVertexArrays(1, &vertexArrayID);
-        glDeleteTextures(1, &textureID);
-        glDeleteProgram(tileProgramID);
+        blocks.clear();
+        shadowProgram.reset();
+        facadeArray.reset();
+        bakedProgram.reset();
+        boundsVAO.reset();
+        boundsProgram.reset();
+        boxes.cleanup();
     }
+
+}; 
+
+// Per-instance record streamed every frame, matches locations 1 to 3 in impostor.vert
+struct ImpostorInstance {
+    glm::vec3 position;
+    glm::vec3 scale;
+    float layer;
 };
 
-struct Building {
-	glm::vec3 position;		// Position of the box 
-	glm::vec3 scale;		// Size of the box in each axis
+// Vertex shader baking a building box into the impostor atlas: facade colour and world normal
+static const char *impostorBakeVertexShader = R"(
+#version 330 core
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 2) in vec2 vertexUV;
+layout(location = 3) in vec3 vertexNormal;
 
-    // Check if a point is inside the building's AABB
-    bool isPointInside(const glm::vec3& point, float margin = 0.5f) const {
-        return (point.x >= position.x - scale.x - margin && point.x <= position.x + scale.x + margin) &&
-            (point.y >= position.y - scale.y - margin && point.y <= position.y + scale.y + margin) &&
-            (point.z >= position.z - scale.z - margin && point.z <= position.z + scale.z + margin);
-    }   
-	
-	GLfloat vertexData[72] = {	// Vertex definition for a canonical box
-		// Front face
-		-1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 
-		
-		// Back face 
-		1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f,
-		
-		// Left face
-        -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 
-
-		// Right face 
-		1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
-
-		// Top face
-		-1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 
-
-		// Bottom face
-        -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 
-	};
-
-	GLfloat colorData[72] = {
-		// Front, red
-		1.0f, 0.0f, 0.0f,
-		1.0f, 0.0f, 0.0f,
-		1.0f, 0.0f, 0.0f,
-		1.0f, 0.0f, 0.0f,
-
-		// Back, yellow
-		1.0f, 1.0f, 0.0f,
-		1.0f, 1.0f, 0.0f,
-		1.0f, 1.0f, 0.0f,
-		1.0f, 1.0f, 0.0f,
-
-		// Left, green
-		0.0f, 1.0f, 0.0f, 
-		0.0f, 1.0f, 0.0f,
-		0.0f, 1.0f, 0.0f,
-		0.0f, 1.0f, 0.0f,
-
-		// Right, cyan
-		0.0f, 1.0f, 1.0f, 
-		0.0f, 1.0f, 1.0f, 
-		0.0f, 1.0f, 1.0f, 
-		0.0f, 1.0f, 1.0f, 
-
-		// Top, blue
-		0.0f, 0.0f, 1.0f, 
-		0.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, 1.0f,
-		0.0f, 0.0f, 1.0f,
-
-		// Bottom, magenta
-		1.0f, 0.0f, 1.0f,
-		1.0f, 0.0f, 1.0f, 
-		1.0f, 0.0f, 1.0f, 
-		1.0f, 0.0f, 1.0f,  
-	};
-
-	GLuint indexData[36] = {		// 12 triangle faces of a box
-		0, 1, 2, 	
-		0, 2, 3, 
-		4, 5, 6, 
-		4, 6, 7, 
-		8, 9, 10, 
-		8, 10, 11, 
-		12, 13, 14, 
-		12, 14, 15, 
-		16, 17, 18, 
-		16, 18, 19, 
-		20, 21, 22, 
-		20, 22, 23, 
-	};
-
-	GLfloat uvData[48] = {
-		// Front
-		0.0f, 1.0f,
-		1.0f, 1.0f,
-		1.0f, 0.0f,
-		0.0f, 0.0f,
-		// Back
-		0.0f, 1.0f,
-		1.0f, 1.0f,
-		1.0f, 0.0f,
-		0.0f, 0.0f,
-		// Left
-		0.0f, 1.0f,
-		1.0f, 1.0f,
-		1.0f, 0.0f,
-		0.0f, 0.0f,
-		// Right
-		0.0f, 1.0f,
-		1.0f, 1.0f,
-		1.0f, 0.0f,
-		0.0f, 0.0f,
-		// Top - we do not want texture the top
-		0.0f, 0.0f,
-		0.0f, 0.0f,
-		0.0f, 0.0f,
-		0.0f, 0.0f,
-		// Bottom - we do not want texture the bottom
-		0.0f, 0.0f,
-		0.0f, 0.0f,
-		0.0f, 0.0f,
-		0.0f, 0.0f,
- 	};
-
-    GLfloat normalData[72] = {
-        // Front face normals
-        0.0f, 0.0f, 1.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f, 1.0f,
-        // Back face normals
-        0.0f, 0.0f, -1.0f,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f, -1.0f,
-        // Left face normals
-        -1.0f, 0.0f, 0.0f,  -1.0f, 0.0f, 0.0f,  -1.0f, 0.0f, 0.0f,  -1.0f, 0.0f, 0.0f,
-        // Right face normals
-        1.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,
-        // Top face normals
-        0.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,
-        // Bottom face normals
-        0.0f, -1.0f, 0.0f,  0.0f, -1.0f, 0.0f,  0.0f, -1.0f, 0.0f,  0.0f, -1.0f, 0.0f,
+uniform mat4 viewProjection;
+uniform vec3 halfExtents;
 
-    };
+out vec2 uv;
+out vec3 normal;
+
+void main() {
+    gl_Position = viewProjection * vec4(vertexPosition * halfExtents, 1.0);
+    uv = vertexUV;
+    normal = vertexNormal;
+}
+)";
+
+static const char *impostorBakeFragmentShader = R"(
+#version 330 core
+in vec2 uv;
+in vec3 normal;
+
+uniform sampler2D textureSampler;
+
+layout(location = 0) out vec4 albedo;
+layout(location = 1) out vec4 packedNormal;
 
-    // OpenGL Buffers
-    GLuint vaoID;           // Vertex Array Object
-    GLuint vboVerticesID;   // Vertex Buffer Object for vertices
-    GLuint vboColorsID;     // Vertex Buffer Object for colors
-    GLuint vboUVsID;        // Vertex Buffer Object for UV coordinates
-    GLuint vboNormalsID;    // Vertex Buffer Object for normals
-    GLuint eboIndicesID;    // Element Buffer Object for indices
-
-    // Shader and Texture IDs
-    GLuint buildingProgramID;          // Shader program ID
-    GLuint mvpUniformID;         // Uniform ID for MVP matrix
-    GLuint modelUniformID;               // Uniform ID for model matrix
-    GLuint textureUniformID;    // Uniform ID for texture sampler
-    GLuint textureObjID;               // Texture object ID
-    GLuint lightPosID;
+void main() {
+    albedo = vec4(texture(textureSampler, uv).rgb, 1.0);
+    packedNormal = vec4(normalize(normal) * 0.5 + 0.5, 1.0);
+}
+)";
+
+// Far level of detail for buildings. Each archetype, a facade and a height bucket, is rendered
+// once from views directions around it into one layer of two atlas arrays, colour and normal.
+// A distant building is then a single camera-facing quad showing the baked views nearest the
+// camera's direction, lit per pixel from the baked normals. All of them share one instanced draw.
+struct ImpostorRenderer {
+    static const int views = 8;             // Matches impostor.vert
+    static const int heightBuckets = 4;
+    static const int cellWidth = 64;        // Texels per baked view
+    static const int cellHeight = 256;
+
+    GLTexture albedoAtlas;
+    GLTexture normalAtlas;
+    int facadeCount = 0;
+    bool baked = false;
+    double bakeMs = 0.0;
+
+    GLProgram program;
+    GLVertexArray vertexArray;
+    GLBuffer cornerBuffer;
     GLuint lightColorID;
 
-    
-    // Constructor
-    Building(glm::vec3 position, glm::vec3 scale)
-        : position(position), scale(scale) {}
-
-        
-
-    // Buffer setup function
-    void setupBuffers() {
-        // Generate and bind VAO
-        glGenVertexArrays(1, &vaoID);
-        glBindVertexArray(vaoID);
-
-        // Vertex buffer
-        glGenBuffers(1, &vboVerticesID);
-        glBindBuffer(GL_ARRAY_BUFFER, vboVerticesID);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
-
-        // Color buffer
-        glGenBuffers(1, &vboColorsID);
-        glBindBuffer(GL_ARRAY_BUFFER, vboColorsID);
-        for (int i = 0; i < 72; ++i) {
-            colorData[i] = 1.0f; // Set each color component to 1
-        }
-        glBufferData(GL_ARRAY_BUFFER, sizeof(colorData), colorData, GL_STATIC_DRAW);
-        for (int i = 0; i < 24; ++i) uvData[2 * i + 1] *= 5;
-
-        // UV buffer
-        glGenBuffers(1, &vboUVsID);
-        glBindBuffer(GL_ARRAY_BUFFER, vboUVsID);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(uvData), uvData, GL_STATIC_DRAW);
-
-        // Normal buffer
-        glGenBuffers(1, &vboNormalsID);
-        glBindBuffer(GL_ARRAY_BUFFER, vboNormalsID);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(normalData), normalData, GL_STATIC_DRAW);
-
-        // Element buffer
-        glGenBuffers(1, &eboIndicesID);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboIndicesID);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
-        
-    }
+    std::vector<ImpostorInstance> instances;   // Staging for this frame's stream write
 
-    // Initialization function
-    void initialize(const glm::vec3& position, const glm::vec3& scale, const std::string& textureFilePath) {
-        this->position = glm::vec3(position.x, scale.y / 2.0f, position.z);
-        this->scale = glm::vec3(scale.x * 0.5f, scale.y, scale.z * 0.5f);
+    void initialize(int facades) {
+        facadeCount = facades;
 
-        // Setup OpenGL buffers
-        setupBuffers();
+        program = GLProgram(LoadShadersFromFile("../FinalProject/impostor.vert", "../FinalProject/impostor.frag"));
+        if (!program) {
+            std::cerr << "Failed to load impostor shaders." << std::endl;
+        }
+        glUniformBlockBinding(program.get(), glGetUniformBlockIndex(program.get(), "FrameData"), frameDataBinding);
+        bindShadowInputs(program.get());
+        lightColorID = glGetUniformLocation(program.get(), "lightColor");
+        glUseProgram(program.get());
+        glUniform1i(glGetUniformLocation(program.get(), "albedoAtlas"), 0);
+        glUniform1i(glGetUniformLocation(program.get(), "normalAtlas"), 1);
+        glUseProgram(0);
 
-        // Load shaders and set up uniforms
-        buildingProgramID = LoadShadersFromFile("../FinalProject/building.vert", "../FinalProject/building.frag");
-        if (buildingProgramID == 0) {
-            std::cerr << "Failed to load shaders." << std::endl;
+        // One quad as a triangle strip, instance attributes pointed at the stream buffer every frame
+        const GLfloat corners[8] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+        vertexArray = GLVertexArray::create();
+        glBindVertexArray(vertexArray.get());
+        cornerBuffer = GLBuffer::create();
+        glBindBuffer(GL_ARRAY_BUFFER, cornerBuffer.get());
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+        for (GLuint attribute = 1; attribute <= 3; ++attribute) {
+            glEnableVertexAttribArray(attribute);
+            glVertexAttribDivisor(attribute, 1);
         }
+        glBindVertexArray(0);
 
-        mvpUniformID = glGetUniformLocation(buildingProgramID, "MVP");
-        modelUniformID = glGetUniformLocation(buildingProgramID, "model");
-        textureUniformID = glGetUniformLocation(buildingProgramID, "textureSampler");
-        textureObjID = LoadTexture(textureFilePath.c_str());
+        albedoAtlas = createAtlas();
+        normalAtlas = createAtlas();
+    }
 
-        lightPosID = glGetUniformLocation(buildingProgramID, "lightPos");
-        lightColorID = glGetUniformLocation(buildingProgramID, "lightColor");
+    GLTexture createAtlas() {
+        GLTexture atlas = GLTexture::create();
+        glBindTexture(GL_TEXTURE_2D_ARRAY, atlas.get());
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, views * cellWidth, cellHeight, facadeCount * heightBuckets,
+            0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return atlas;
+    }
 
+    static int heightBucket(float height) {
+        int bucket = (int)((height - minBuildingHeight) * heightBuckets / buildingHeightSteps);
+        return std::min(std::max(bucket, 0), heightBuckets - 1);
     }
 
-    void render(glm::mat4 cameraMatrix) {
-        glUseProgram(buildingProgramID);
+    // Height each bucket is baked at, the quads stretch it to the building's own
+    static float bucketHeight(int bucket) {
+        return minBuildingHeight + (bucket + 0.5f) * buildingHeightSteps / heightBuckets;
+    }
 
-        // Calculate and send the model matrix
-        glm::mat4 modelMatrix = glm::mat4(1.0f);
-        modelMatrix = glm::translate(modelMatrix, position);
-        modelMatrix = glm::scale(modelMatrix, scale);
-        glUniformMatrix4fv(modelUniformID, 1, GL_FALSE, &modelMatrix[0][0]);
+    static int layerOf(int facade, float height) {
+        return facade * heightBuckets + heightBucket(height);
+    }
 
-        // Calculate and send the MVP matrix
-        glm::mat4 mvp = cameraMatrix * modelMatrix;
-        glUniformMatrix4fv(mvpUniformID, 1, GL_FALSE, &mvp[0][0]);
+    // Render every archetype into the atlases. The facade textures must have finished loading.
+    void bake(const BuildingRenderer& renderer) {
+        double start = glfwGetTime();
 
-        glm::vec3 lightPosition = glm::vec3(50.0f, 80.0f, 50.0f);
-        glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 0.8f);
-        glUniform3fv(lightPosID, 1, &lightPosition[0]);
-        glUniform3fv(lightColorID, 1, &lightColor[0]);
+        GLProgram bakeProgram(LoadShadersFromString(impostorBakeVertexShader, impostorBakeFragmentShader));
+        GLint viewProjectionID = glGetUniformLocation(bakeProgram.get(), "viewProjection");
+        GLint halfExtentsID = glGetUniformLocation(bakeProgram.get(), "halfExtents");
+        glUseProgram(bakeProgram.get());
+        glUniform1i(glGetUniformLocation(bakeProgram.get(), "textureSampler"), 0);
 
-        // Enable vertex attributes and bind buffers
-        glEnableVertexAttribArray(0); // Position
-        glBindBuffer(GL_ARRAY_BUFFER, vboVerticesID);
+        // The canonical box with the attributes the bake reads
+        GLVertexArray boxArray = GLVertexArray::create();
+        glBindVertexArray(boxArray.get());
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, renderer.boxes.vertexBuffer());
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(2);
+        glBindBuffer(GL_ARRAY_BUFFER, renderer.boxes.uvBuffer());
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(3);
+        glBindBuffer(GL_ARRAY_BUFFER, renderer.boxes.normalBuffer());
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.boxes.indexBuffer());
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        GLFramebuffer framebuffer = GLFramebuffer::create();
+        GLRenderbuffer depth = GLRenderbuffer::create();
+        glBindRenderbuffer(GL_RENDERBUFFER, depth.get());
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, views * cellWidth, cellHeight);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth.get());
+        const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, drawBuffers);
+
+        const GLfloat transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        const GLfloat farDepth = 1.0f;
+        glActiveTexture(GL_TEXTURE0);
 
-        glEnableVertexAttribArray(1); //Colors
-        glBindBuffer(GL_ARRAY_BUFFER, vboColorsID);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        for (int facade = 0; facade < facadeCount; ++facade) {
+            glBindTexture(GL_TEXTURE_2D, renderer.boxes.batches[facade].texture);
+
+            for (int bucket = 0; bucket < heightBuckets; ++bucket) {
+                int layer = facade * heightBuckets + bucket;
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, albedoAtlas.get(), 0, layer);
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, normalAtlas.get(), 0, layer);
+                if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                    std::cerr << "Impostor atlas framebuffer is incomplete." << std::endl;
+                    break;
+                }
+                glClearBufferfv(GL_COLOR, 0, transparent);
+                glClearBufferfv(GL_COLOR, 1, transparent);
+                glClearBufferfv(GL_DEPTH, 0, &farDepth);
+
+                // Orthographic views from the horizon, framed exactly like the quads in impostor.vert
+                glm::vec3 halfExtents(buildingHalfWidth, bucketHeight(bucket), buildingHalfWidth);
+                float halfWidth = buildingHalfWidth * 1.41421356f;
+                float radius = halfExtents.y + halfWidth;
+                glm::mat4 projection = glm::ortho(-halfWidth, halfWidth, -halfExtents.y, halfExtents.y, 0.0f, 2.0f * radius);
+                glUniform3fv(halfExtentsID, 1, &halfExtents[0]);
+
+                for (int view = 0; view < views; ++view) {
+                    float azimuth = view * 2.0f * (float)M_PI / views;
+                    glm::vec3 direction(std::sin(azimuth), 0.0f, std::cos(azimuth));
+                    glm::mat4 viewProjection = projection * glm::lookAt(direction * radius, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+                    glViewport(view * cellWidth, 0, cellWidth, cellHeight);
+                    glUniformMatrix4fv(viewProjectionID, 1, GL_FALSE, &viewProjection[0][0]);
+                    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (void*)0);
+                }
+            }
+        }
 
-        glEnableVertexAttribArray(2); //UVs
-        glBindBuffer(GL_ARRAY_BUFFER, vboUVsID);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glBindVertexArray(0);
+        glUseProgram(0);
 
-        glEnableVertexAttribArray(3); // Normals
-        glBindBuffer(GL_ARRAY_BUFFER, vboNormalsID);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        // Distant quads are a few pixels wide, so they read from the small mip levels
+        glBindTexture(GL_TEXTURE_2D_ARRAY, albedoAtlas.get());
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, normalAtlas.get());
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        baked = true;
+        bakeMs = (glfwGetTime() - start) * 1000.0;
+    }
+
+    // Draw the given buildings as impostors, their records written to this frame's stream region.
+    // FrameData must already be bound to frameDataBinding.
+    void render(const std::vector<uint32_t>& distant, const BuildingStore& store, StreamBuffer& stream) {
+        if (distant.empty())
+            return;
+
+        instances.clear();
+        for (uint32_t index : distant) {
+            const glm::vec3& scale = store.halfExtents[index];
+            instances.push_back({ store.positions[index], scale, (float)layerOf(store.facades[index], scale.y) });
+        }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboIndicesID); 
+        GLintptr offset = stream.write(instances.data(), instances.size() * sizeof(ImpostorInstance));
+        if (offset < 0)
+            return;
 
-        // Bind Texture 
+        glUseProgram(program.get());
+        glUniform3fv(lightColorID, 1, &sunColor[0]);
+
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, normalAtlas.get());
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureObjID);
-        glUniform1i(textureUniformID, 0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, albedoAtlas.get());
 
-        // Draw the building
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT,(void*)0);
+        glBindVertexArray(vertexArray.get());
+        glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ImpostorInstance), (void*)(offset + offsetof(ImpostorInstance, position)));
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ImpostorInstance), (void*)(offset + offsetof(ImpostorInstance, scale)));
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(ImpostorInstance), (void*)(offset + offsetof(ImpostorInstance, layer)));
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)instances.size());
 
-        glDisableVertexAttribArray(0);
-        glDisableVertexAttribArray(1);
-        glDisableVertexAttribArray(2);
-        glDisableVertexAttribArray(3);
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
     }
 
     void cleanup() {
-        glDeleteBuffers(1, &vboVerticesID);
-        glDeleteBuffers(1, &vboColorsID);
-        glDeleteBuffers(1, &eboIndicesID);
-        glDeleteBuffers(1, &vboNormalsID);
-        glDeleteVertexArrays(1, &vaoID);
-        glDeleteBuffers(1, &vboUVsID);
-        glDeleteTextures(1, &textureObjID);
-        glDeleteProgram(buildingProgramID);
+        vertexArray.reset();
+        cornerBuffer.reset();
+        albedoAtlas.reset();
+        normalAtlas.reset();
+        program.reset();
     }
-
-}; 
+};
 
 std::vector<Tile> tiles;
-std::vector<Building> buildings;
+BuildingStore buildings;
+SpatialGrid buildingGrid(cellSize);  // Indices into buildings, bucketed by tile
+std::mutex buildingsMutex;  // Collision reads buildings on the simulation thread
 std::vector<std::string> BuildingFacades;
 Skybox skybox;
+TileRenderer tileRenderer;
+BuildingRenderer buildingRenderer;
+ImpostorRenderer impostorRenderer;
+
+// Instance records and per-frame uniforms, rewritten every frame without waiting on the GPU.
+// Sized for the tiles and impostors of a view distance several times the default.
+StreamBuffer frameStream(1024 * 1024);
+
+// CPU occlusion culling: the buildings likely to hide the most are drawn into a small depth
+// buffer, then every building and tile in view distance is tested against it
+OcclusionCuller occlusionCuller;
+static const int maxOccluders = 32;
+static const float occluderDistance = 40.0f;    // Farther buildings rarely cover enough screen to be worth drawing
+static float viewDistance = 100.0f;             // The far plane, set from the command line
+
+// Buildings past impostorDistance are drawn as impostors. Meshes fade out over the last
+// impostorFadeBand before it, dithered against the impostors fading in.
+static float impostorDistance = 50.0f;
+static const float impostorFadeBand = 8.0f;
+
+// Buildings in view distance split by level of detail, either may be in both during the fade
+struct LodSplit {
+    std::vector<uint32_t> meshes;
+    std::vector<uint32_t> impostors;
+};
+
+// What survived culling this frame
+struct CullResult {
+    std::vector<uint32_t> buildings;    // Indices into the BuildingStore
+    std::vector<Tile> tiles;
+    int occludedBuildings = 0;
+    int occludedTiles = 0;
+};
+
+// Buildings are generated per chunk: a square block of chunkCells x chunkCells grid cells
+static const int chunkCells = 4;
+static const int maxChunkUploadsPerFrame = 8;
+static unsigned int citySeed = 12345;
+
+// Buildings placed in one chunk by a worker, waiting to be handed to the GL thread
+struct BuildingChunk {
+    int chunkX;
+    int chunkZ;
+    std::vector<Building> buildings;
+    ChunkMesh mesh;
+};
+
+std::unordered_set<std::tuple<int, int>, TupleHash> requestedChunks;
+std::deque<BuildingChunk> completedChunks;
+std::mutex completedChunksMutex;
+ThreadPool chunkWorkers;
+
+// Tiles cover the cells within renderDistance of the camera, the streamer reports the cells that
+// came into range and those that went out of it, so the streamed tiles stay bounded
+ChunkStreamer tileStreamer(cellSize, renderDistance);
 
 void generateTiles(glm::vec3 position) {
-    int centerX = static_cast<int>(std::floor(position.x / cellSize));
-    int centerZ = static_cast<int>(std::floor(position.z / cellSize));
-    // Iterate over a square area around the center position based on the render distance
-    for (int x = centerX - renderDistance; x <= centerX + renderDistance; ++x) {
-        // Compute the position of the current tile in world coordinates.
-        for (int z = centerZ - renderDistance; z <= centerZ + renderDistance; ++z) {
-            glm::vec3 tilePosition = glm::vec3(x * cellSize, 0.0f, z * cellSize);
-            // Check if the tile at this position already exists in the list of tiles
-            if (std::none_of(tiles.begin(), tiles.end(), [&](const Tile& t) {
-                return t.position == tilePosition;
-            })) {
-                // does not exist, create a new tile
-                Tile newTile(tilePosition, cellSize); // Initialize the new tile with the specified texture
-                newTile.initialize("../FinalProject/tile4.jpg");
-                tiles.push_back(newTile); // Add the new tile to the list of tiles.
-            }
-        }
+    std::vector<ChunkCoord> entered, left;
+    if (!tileStreamer.update(position, entered, left))
+        return;
+
+    // Drop the tiles of the cells out of range, each tile sits at its cell times cellSize
+    if (!left.empty()) {
+        std::unordered_set<ChunkCoord, TupleHash> leftCells(left.begin(), left.end());
+        tiles.erase(std::remove_if(tiles.begin(), tiles.end(), [&](const Tile& tile) {
+            ChunkCoord cell((int)std::lround(tile.position.x / cellSize), (int)std::lround(tile.position.z / cellSize));
+            return leftCells.count(cell) != 0;
+        }), tiles.end());
+    }
+
+    for (const ChunkCoord& cell : entered) {
+        // Compute the position of the new tile in world coordinates.
+        glm::vec3 tilePosition = glm::vec3(std::get<0>(cell) * cellSize, 0.0f, std::get<1>(cell) * cellSize);
+        tiles.push_back(Tile(tilePosition, cellSize)); // Add the new tile to the list of tiles, TileRenderer draws them all
     }
 }
 
@@ -783,262 +939,742 @@ void initializeBuildingFacades() {
     BuildingFacades.push_back("../FinalProject/facade4.jpg");
 }
 
-// Function to get a random facade texture
-std::string getRandomFacade() {
-    int randomIndex = rand() % BuildingFacades.size();
-    return BuildingFacades[randomIndex];
+// Integer floor division, so negative cells map to the chunk on their left
+static int floorDiv(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// Stateless per-cell random value, so any worker produces the same building for a cell
+static unsigned int cellHash(int x, int z) {
+    return LatticeHash(x, z, citySeed);
 }
 
-void generateBuildings(glm::vec3 position) {
+// CPU stage: decide placement, size and facade for every cell of a chunk. Runs on a worker thread.
+BuildingChunk populateBuildingChunk(int chunkX, int chunkZ, int facadeCount) {
+    BuildingChunk chunk;
+    chunk.chunkX = chunkX;
+    chunk.chunkZ = chunkZ;
+
+    for (int cx = 0; cx < chunkCells; ++cx) {
+        for (int cz = 0; cz < chunkCells; ++cz) {
+            int x = chunkX * chunkCells + cx;
+            int z = chunkZ * chunkCells + cz;
+
+            // The hash's low bits are biased, bit 0 is always set
+            unsigned int hash = cellHash(x, z);
+            if ((hash >> 4) % 2 != 0)
+                continue; // roughly half of the cells hold a building
+
+            float buildingHeight = minBuildingHeight + static_cast<float>((hash >> 8) % buildingHeightSteps); // Random height
+            int facade = static_cast<int>((hash >> 16) % facadeCount);
+
+            // Box centre and half extents, the building starts on top of the tile
+            glm::vec3 buildingPosition(x * cellSize, buildingHeight / 2.0f, z * cellSize);
+            glm::vec3 buildingScale(buildingHalfWidth, buildingHeight, buildingHalfWidth);
+
+            chunk.buildings.push_back(Building(buildingPosition, buildingScale, facade));
+        }
+    }
+    return chunk;
+}
+
+// Merge a chunk's buildings into one mesh: the canonical box of BuildingRenderer scaled and moved
+// into place, with the facade as the texture layer. Runs on a worker thread, after the box data
+// has been set up on the GL thread.
+void bakeChunkMesh(BuildingChunk& chunk, const BuildingRenderer& box) {
+    ChunkMesh& mesh = chunk.mesh;
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    mesh.vertices.reserve(chunk.buildings.size() * 24);
+    mesh.indices.reserve(chunk.buildings.size() * 36);
+
+    for (const Building& building : chunk.buildings) {
+        GLushort first = (GLushort)mesh.vertices.size();
+        for (int v = 0; v < 24; ++v) {
+            BakedVertex vertex;
+            glm::vec3 corner(BoxRenderer::positions[3 * v], BoxRenderer::positions[3 * v + 1], BoxRenderer::positions[3 * v + 2]);
+            vertex.position = building.position + corner * building.scale;
+            vertex.normal = glm::vec3(BoxRenderer::normals[3 * v], BoxRenderer::normals[3 * v + 1], BoxRenderer::normals[3 * v + 2]);
+            vertex.uv = glm::vec2(box.boxes.uvs[2 * v], box.boxes.uvs[2 * v + 1]);
+            vertex.layer = (float)building.facade;
+            mesh.vertices.push_back(vertex);
+        }
+        for (int i = 0; i < 36; ++i)
+            mesh.indices.push_back(first + (GLushort)BoxRenderer::indices[i]);
+    }
+}
+
+// Queue every chunk within the render distance that has not been generated yet. Chunk meshes are
+// only baked with bakeMeshes, when block queries will draw them; the other modes draw instances.
+void generateBuildings(glm::vec3 position, bool bakeMeshes) {
     int centerX = static_cast<int>(std::floor(position.x / cellSize));
     int centerZ = static_cast<int>(std::floor(position.z / cellSize));
 
-    for (int x = centerX - renderDistance; x <= centerX + renderDistance; ++x) {
-        for (int z = centerZ - renderDistance; z <= centerZ + renderDistance; ++z) {
-            glm::vec3 buildingPosition = glm::vec3(x * cellSize, 0.0f, z * cellSize);
-            if (rand() % 2 == 0 && std::none_of(buildings.begin(), buildings.end(), [&](const Building& b) {
-                return b.position.x == buildingPosition.x && b.position.z == buildingPosition.z;
-            })) {
-                float buildingHeight = 5.0f + static_cast<float>(rand() % 15); // Random height
-                glm::vec3 buildingScale(5.0f, buildingHeight, 5.0f);
+    int minChunkX = floorDiv(centerX - renderDistance, chunkCells);
+    int maxChunkX = floorDiv(centerX + renderDistance, chunkCells);
+    int minChunkZ = floorDiv(centerZ - renderDistance, chunkCells);
+    int maxChunkZ = floorDiv(centerZ + renderDistance, chunkCells);
+    int facadeCount = static_cast<int>(BuildingFacades.size());
+
+    for (int chunkX = minChunkX; chunkX <= maxChunkX; ++chunkX) {
+        for (int chunkZ = minChunkZ; chunkZ <= maxChunkZ; ++chunkZ) {
+            if (!requestedChunks.insert(std::make_tuple(chunkX, chunkZ)).second)
+                continue;
+
+            chunkWorkers.submit([chunkX, chunkZ, facadeCount, bakeMeshes]() {
+                BuildingChunk chunk = populateBuildingChunk(chunkX, chunkZ, facadeCount);
+                if (bakeMeshes)
+                    bakeChunkMesh(chunk, buildingRenderer);
+                std::lock_guard<std::mutex> lock(completedChunksMutex);
+                completedChunks.push_back(std::move(chunk));
+            });
+        }
+    }
+}
+
+// Benchmark runs must not depend on worker timing: wait for every queued chunk and upload them in a fixed order
+void finishBuildingChunks() {
+    chunkWorkers.waitIdle();
+
+    std::lock_guard<std::mutex> lock(completedChunksMutex);
+    std::sort(completedChunks.begin(), completedChunks.end(), [](const BuildingChunk& a, const BuildingChunk& b) {
+        return std::tie(a.chunkX, a.chunkZ) < std::tie(b.chunkX, b.chunkZ);
+    });
+}
+
+// GL stage: append finished chunks to the instance buffers. Runs on the render thread.
+void uploadBuildingChunks() {
+    std::vector<BuildingChunk> ready;
+    {
+        std::lock_guard<std::mutex> lock(completedChunksMutex);
+        while (!completedChunks.empty() && (int)ready.size() < maxChunkUploadsPerFrame) {
+            ready.push_back(std::move(completedChunks.front()));
+            completedChunks.pop_front();
+        }
+    }
 
-                // Ensure the building starts on top of the tile
-                glm::vec3 adjustedBuildingPosition = buildingPosition + glm::vec3(0.0f, buildingHeight / 2.0f, 0.0f);
+    for (const BuildingChunk& chunk : ready) {
+        std::vector<uint32_t> slots;
+        buildingRenderer.append(chunk.buildings, chunk.mesh, slots);
 
-                // Create and initialize the building
-                Building newBuilding(adjustedBuildingPosition, buildingScale);
-                newBuilding.initialize(buildingPosition, buildingScale, getRandomFacade());
-                buildings.push_back(newBuilding);
+        // The chunk's buildings now cast shadows into the cascades around them
+        if (!chunk.buildings.empty()) {
+            const BuildingBlock& block = buildingRenderer.blocks.back();
+            shadowCascades.invalidate(block.center, block.halfExtents);
+        }
 
-            }
+        std::lock_guard<std::mutex> lock(buildingsMutex);
+        for (size_t i = 0; i < chunk.buildings.size(); ++i) {
+            uint32_t index = buildings.add(chunk.buildings[i], slots[i]);
+            buildingGrid.insert(index, buildings.positions[index], buildings.halfExtents[index]);
         }
     }
 }
 
-int main() {
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW." << std::endl;
-        return -1;
+// Test the buildings and tiles within view distance against the nearest large buildings
+void cullScene(const glm::mat4& vp, const glm::vec3& eye, CullResult& result) {
+    static std::vector<uint32_t> candidates;
+    static std::vector<std::pair<float, uint32_t>> occluders;
+    static std::vector<glm::vec3> tileCenters;
+    static std::vector<glm::vec3> tileHalfExtents;
+    static std::vector<uint32_t> tileIds;
+    static std::vector<uint32_t> visibleTiles;
+
+    // Buildings are only added on this thread, so reading them needs no lock
+    buildingGrid.query(glm::vec2(eye.x, eye.z) - viewDistance, glm::vec2(eye.x, eye.z) + viewDistance, candidates);
+
+    // Rank nearby buildings by how much of the screen they can cover, roughly their side area over distance squared
+    occluders.clear();
+    for (uint32_t index : candidates) {
+        const glm::vec3& center = buildings.positions[index];
+        const glm::vec3& halfExtent = buildings.halfExtents[index];
+        glm::vec3 offset = center - eye;
+        float distanceSquared = glm::dot(offset, offset);
+        if (distanceSquared > occluderDistance * occluderDistance)
+            continue;
+        float area = halfExtent.y * std::max(halfExtent.x, halfExtent.z);
+        occluders.push_back(std::make_pair(-area / std::max(distanceSquared, 1.0f), index));
     }
+    size_t occluderCount = std::min(occluders.size(), (size_t)maxOccluders);
+    std::partial_sort(occluders.begin(), occluders.begin() + occluderCount, occluders.end());
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    occlusionCuller.beginFrame(vp, eye);
+    for (size_t i = 0; i < occluderCount; ++i) {
+        uint32_t index = occluders[i].second;
+        occlusionCuller.addOccluder(buildings.positions[index], buildings.halfExtents[index]);
+    }
+    occlusionCuller.rasterize();
+
+    result.buildings.clear();
+    occlusionCuller.cullBoxes(candidates, buildings.positions.data(), buildings.halfExtents.data(), result.buildings);
+    result.occludedBuildings = occlusionCuller.occluded;
+
+    // Tiles are flat boxes at ground level
+    tileCenters.clear();
+    tileHalfExtents.clear();
+    tileIds.clear();
+    for (const Tile& tile : tiles) {
+        tileIds.push_back((uint32_t)tileCenters.size());
+        tileCenters.push_back(tile.position);
+        tileHalfExtents.push_back(glm::vec3(tile.scale * 0.5f, 0.0f, tile.scale * 0.5f));
+    }
+    visibleTiles.clear();
+    occlusionCuller.cullBoxes(tileIds, tileCenters.data(), tileHalfExtents.data(), visibleTiles);
+    result.occludedTiles = occlusionCuller.occluded - result.occludedBuildings;
 
-    window = glfwCreateWindow(windowWidth, windowHeight, "SkyBox Implementation", NULL, NULL);
-    if (window == NULL) {
-        std::cerr << "Failed to open a GLFW window." << std::endl;
-        glfwTerminate();
-        return -1;
+    result.tiles.clear();
+    for (uint32_t index : visibleTiles)
+        result.tiles.push_back(tiles[index]);
+}
+
+// Sort the candidate buildings into meshes and impostors by horizontal distance to their centre,
+// as building.vert and impostor.vert measure it for the fade
+void splitLevelsOfDetail(const std::vector<uint32_t>& candidates, const glm::vec3& eye, LodSplit& split) {
+    split.meshes.clear();
+    split.impostors.clear();
+    float fadeStart = impostorDistance - impostorFadeBand;
+    for (uint32_t index : candidates) {
+        const glm::vec3& position = buildings.positions[index];
+        float distance = glm::length(glm::vec2(position.x - eye.x, position.z - eye.z));
+        if (distance < impostorDistance)
+            split.meshes.push_back(index);
+        if (distance > fadeStart)
+            split.impostors.push_back(index);
     }
-    glfwMakeContextCurrent(window);
+}
+
+int main(int argc, char **argv) {
+    // Headless benchmark mode, see benchmark.h for the options
+    BenchmarkOptions benchmark;
+    if (!benchmark.parse(argc, argv))
+        return -1;
+
+    CameraPath cameraPath;
+    if (benchmark.enabled && !benchmark.pathFile.empty() && !cameraPath.load(benchmark.pathFile.c_str()))
+        return -1;
 
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetKeyCallback(window, key_callback);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    // Generate tiles and buildings out to the far plane
+    viewDistance = benchmark.viewDistance;
+    impostorDistance = benchmark.impostorDistance;
+    renderDistance = static_cast<int>(std::ceil(viewDistance / cellSize));
+    tileStreamer = ChunkStreamer(cellSize, renderDistance);
+
+    SceneWindowOptions windowOptions;
+    windowOptions.width = windowWidth;
+    windowOptions.height = windowHeight;
+    windowOptions.captureCursor = !benchmark.enabled;
+    if (benchmark.enabled) {
+        // No display is needed for benchmarking: EGL surfaceless on a GPU, or OSMesa/llvmpipe on a
+        // machine without one, and frames are paced by the work, not the display
+        windowOptions.visible = false;
+        windowOptions.nullPlatform = true;
+        windowOptions.contextApi = benchmark.useOSMesa ? GLFW_OSMESA_CONTEXT_API : GLFW_EGL_CONTEXT_API;
+        windowOptions.swapInterval = 0;
+    }
 
-    if (!gladLoadGL(glfwGetProcAddress)) {
-        std::cerr << "Failed to initialize GLAD" << std::endl;
+    window = CreateSceneWindow("SkyBox Implementation", windowOptions);
+    if (window == NULL)
         return -1;
+
+    if (!benchmark.enabled) {
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetKeyCallback(window, key_callback);
     }
 
     glClearColor(0.05f, 0.05f, 0.2f, 1.0f);
     glEnable(GL_DEPTH_TEST);
 
-    skybox.initialize(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(500.0f, 500.0f, 500.0f)); 
+    // Shaders and textures come from the packed archive when it has been built (see packassets.cpp),
+    // anything missing from it is still loaded from its own file
+    if (DefaultAssetPack().open("../FinalProject/assets.pack")) {
+        std::cout << "Asset pack mounted: " << DefaultAssetPack().entryCount() << " entries" << std::endl;
+    }
+
+    skybox.initialize("../FinalProject/skybox.vert", "../FinalProject/skybox.frag", "../FinalProject/sky3.png");
+
+    citySeed = benchmark.enabled ? benchmark.seed : static_cast<unsigned int>(time(nullptr));
 
-    srand(static_cast<unsigned int>(time(nullptr)));
+    input.setCursorHandler(applyMouseMovement);
+    if (!benchmark.replayFile.empty()) {
+        if (!input.startReplay(benchmark.replayFile.c_str())) {
+            glfwTerminate();
+            return -1;
+        }
+        citySeed = input.seed();
+        std::cout << "Replaying " << input.eventCount() << " input events over " << input.lastTick() << " ticks" << std::endl;
+    } else if (!benchmark.recordFile.empty()) {
+        input.startRecording(benchmark.recordFile.c_str(), citySeed);
+    }
+    frameStream.initialize(glfwGetProcAddress);
+    GLint uniformAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+
+    // The tile program reads VP from FrameData and its sun from the shadow data
+    tileRenderer.initialize("../FinalProject/tile_instanced.vert", "../FinalProject/tile.frag", "../FinalProject/tile4.jpg");
+    glUniformBlockBinding(tileRenderer.programID(), glGetUniformBlockIndex(tileRenderer.programID(), "FrameData"), frameDataBinding);
+    bindShadowInputs(tileRenderer.programID());
+    glUseProgram(tileRenderer.programID());
+    glUniform3fv(glGetUniformLocation(tileRenderer.programID(), "lightColor"), 1, &sunColor[0]);
+    glUseProgram(0);
     initializeBuildingFacades();
+    buildingRenderer.initialize(BuildingFacades);
+    impostorRenderer.initialize(static_cast<int>(BuildingFacades.size()));
+    shadowCascades.initialize();
+    shadowCascades.configure(towardsSun, viewDistance);
+
+    // GPU pass names of the cascades, the profiler keeps the pointers
+    static const char *cascadePassNames[ShadowCascades::cascadeCount] = { "shadow cascade 0", "shadow cascade 1", "shadow cascade 2" };
+
+    // Per-stage CPU and GPU timings, exported as a Chrome trace on exit
+    FrameProfiler profiler;
+    profiler.initialize();
 
     // Time and frame rate tracking
-	static double lastTime = glfwGetTime();
-	float fTime = 0.0f;			// Time for measuring fps
-	unsigned long frames = 0;
+    static double lastTime = glfwGetTime();
+    float fTime = 0.0f;         // Time for measuring fps
+    unsigned long frames = 0;
+    float worstFrame = 0.0f;    // Longest frame in the current fps window
+
+    // Benchmark samples, in milliseconds
+    int benchmarkFrame = 0;
+    std::vector<double> frameSamples;
+    std::vector<double> generationSamples;
+    std::vector<double> cullSamples;
+    std::vector<double> textureSamples;
+
+    bool occlusionCulling = benchmark.occlusion == "cpu";
+    bool occlusionQueries = benchmark.occlusion == "gpu";
+    bool skyFirst = benchmark.sky == "first";
+    CullResult culled;
+
+    // Block queries draw whole chunks of meshes, so impostors only go with the other modes
+    bool impostors = impostorDistance > 0.0f && !occlusionQueries;
+    std::vector<uint32_t> lodCandidates;
+    LodSplit lod;
+
+    if (benchmark.enabled) {
+        // Start from a fully loaded scene so the first frames don't measure texture decoding
+        if (!input.replaying())
+            followCameraPath(cameraPath, 0.0);
+        generateTiles(flyCamera.position);
+        while (benchmark.textures == "preload" && DefaultTextureLoader().pending() > 0)
+            DefaultTextureLoader().update(1.0);
+        glFinish();
+    }
+
+    // One simulation step: apply the input due, then move the camera. Runs on the simulation
+    // thread with --sim-thread, so it only touches camera state and reads buildings under their lock.
+    bool followPath = benchmark.enabled && !input.replaying();
+    double simulationTime = 0.0;
+    SimulationLoop simulation(simulationTickSeconds, [&](double tickSeconds) {
+        input.beginTick();
+        simulationTime += tickSeconds;
+        if (followPath)
+            followCameraPath(cameraPath, simulationTime);
+        else
+            handleCameraMovement(tickSeconds);
+        return CameraState{flyCamera.position, flyCamera.yaw, flyCamera.pitch};
+    }, CameraState{flyCamera.position, flyCamera.yaw, flyCamera.pitch});
+
+    // Benchmarks tick on the render thread so every run performs the same ticks per frame
+    if (benchmark.simulationThread && !benchmark.enabled)
+        simulation.startThread();
 
     while (!glfwWindowShouldClose(window)) {
-        // Handle camera movement
-        handleCameraMovement(window);
+        if (benchmark.enabled && benchmark.frames > 0 && benchmarkFrame >= benchmark.frames)
+            break;
+        if (input.replayFinished())
+            break;
+
+        profiler.beginFrame();
+        double frameStart = glfwGetTime();
 
         // Update states for animation
         double currentTime = glfwGetTime();
         float deltaTime = float(currentTime - lastTime);
-		lastTime = currentTime;
+        lastTime = currentTime;
+
+        // Run the ticks owed for the elapsed time, a benchmark frame always covers one timestep
+        if (!simulation.threaded()) {
+            ProfileScope scope(profiler, "simulation");
+            simulation.advance(benchmark.enabled ? benchmark.timestep : deltaTime);
+        }
+
+        // Draw the camera between the last two ticks
+        CameraState camera = simulation.renderState();
+        glm::vec3 eye = camera.position;
+        glm::vec3 front = CameraFront(camera.yaw, camera.pitch);
 
         // Clear the screen (only once per frame)
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Render the Skybox
-        glDepthMask(GL_FALSE); // Disable depth writing
-        glUseProgram(skyboxProgramID);
+        // Generate tiles and buildings dynamically based on the camera position
+        double generationStart = glfwGetTime();
+        profiler.beginScope("generation");
+        {
+            ProfileScope scope(profiler, "generate tiles");
+            generateTiles(eye);
+        }
+        {
+            ProfileScope scope(profiler, "generate buildings");
+            generateBuildings(eye, occlusionQueries);
+            if (benchmark.enabled)
+                finishBuildingChunks();
+            uploadBuildingChunks();
+        }
+        {
+            ProfileScope scope(profiler, "texture uploads");
+            double uploadStart = glfwGetTime();
+            if (benchmark.enabled && benchmark.textures == "sync") {
+                // Wait for every requested texture, as loading them on this thread would
+                while (DefaultTextureLoader().pending() > 0)
+                    DefaultTextureLoader().update(1.0);
+            } else {
+                DefaultTextureLoader().update(textureUploadBudget);
+            }
+            if (benchmark.enabled)
+                textureSamples.push_back((glfwGetTime() - uploadStart) * 1000.0);
+        }
+        if (occlusionQueries && !buildingRenderer.facadeArray && DefaultTextureLoader().pending() == 0) {
+            ProfileScope scope(profiler, "facade array");
+            buildingRenderer.buildFacadeArray();
+        }
+        if (impostors && !impostorRenderer.baked && DefaultTextureLoader().pending() == 0) {
+            ProfileScope scope(profiler, "impostor bake");
+            impostorRenderer.bake(buildingRenderer);
+        }
+        profiler.endScope();
+        double generationTime = glfwGetTime() - generationStart;
 
-        glm::mat4 skyboxViewMatrix = glm::mat4(glm::mat3(glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp)));
-        glm::mat4 skyboxProjection = glm::perspective(glm::radians(45.0f), (float)windowWidth / windowHeight, 0.1f, 1000.0f);
+        // Calculate view-projection matrix for tiles and buildings
+        glm::mat4 view = glm::lookAt(eye, eye + front, flyCamera.up);
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)windowWidth / windowHeight, 0.1f, viewDistance);
+        glm::mat4 vp = projection * view;
 
-        skybox.render(skyboxProjection * skyboxViewMatrix);
+        // Decide what to draw before anything is submitted
+        if (occlusionCulling) {
+            ProfileScope scope(profiler, "culling");
+            double cullStart = glfwGetTime();
+            cullScene(vp, eye, culled);
+            if (benchmark.enabled)
+                cullSamples.push_back((glfwGetTime() - cullStart) * 1000.0);
+        }
 
-        glDepthMask(GL_TRUE); // Re-enable depth writing for other objects
-        glUseProgram(0);
+        // Redraw the cascades the camera has moved a snap step in, or that new chunks reach into
+        profiler.beginScope("shadows");
+        shadowCascades.update(eye);
+        for (int cascade = 0; cascade < ShadowCascades::cascadeCount; ++cascade) {
+            if (!shadowCascades.stale(cascade))
+                continue;
+            profiler.beginGpuPass(cascadePassNames[cascade]);
+            shadowCascades.beginCascade(cascade);
+            buildingRenderer.renderShadowCasters(shadowCascades.lightViewProjection(cascade));
+            shadowCascades.endCascade();
+            profiler.endGpuPass();
+        }
+        profiler.endScope();
 
-        // Generate tiles and buildings dynamically based on the camera position
-        generateTiles(cameraPos);
-        generateBuildings(cameraPos);
+        // Claim this frame's stream region and publish the per-frame uniforms
+        {
+            ProfileScope scope(profiler, "stream wait");
+            frameStream.beginFrame();
+        }
+        bool drawImpostors = impostors && impostorRenderer.baked;
+        glm::vec4 lodRange = drawImpostors ? glm::vec4(impostorDistance - impostorFadeBand, impostorDistance, 0.0f, 0.0f)
+                                           : glm::vec4(1e30f, 2e30f, 0.0f, 0.0f);
+        FrameData frameData = {vp, glm::vec4(eye, 1.0f), lodRange};
+        GLintptr frameDataOffset = frameStream.write(&frameData, sizeof(frameData), uniformAlignment);
+        glBindBufferRange(GL_UNIFORM_BUFFER, frameDataBinding, frameStream.buffer(), frameDataOffset, sizeof(frameData));
+
+        ShadowCascades::Uniforms shadowData = shadowCascades.uniforms();
+        GLintptr shadowDataOffset = frameStream.write(&shadowData, sizeof(shadowData), uniformAlignment);
+        glBindBufferRange(GL_UNIFORM_BUFFER, shadowDataBinding, frameStream.buffer(), shadowDataOffset, sizeof(shadowData));
+        glActiveTexture(GL_TEXTURE0 + shadowTextureUnit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, shadowCascades.texture());
+        glActiveTexture(GL_TEXTURE0);
 
-        // Calculate view-projection matrix for tiles and buildings
-        glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-        glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)windowWidth / windowHeight, 0.1f, 100.0f);
-        glm::mat4 vp = projection * view;
+        // Only for comparing costs: the sky under the whole scene, shading every pixel
+        if (skyFirst) {
+            profiler.beginScope("skybox");
+            profiler.beginGpuPass("skybox");
+            skybox.render(projection, view, false);
+            glUseProgram(0);
+            profiler.endGpuPass();
+            profiler.endScope();
+        }
 
         // Render Tiles
-        glUseProgram(tileProgramID);
-        for (auto& tile : tiles) {
-            glBindVertexArray(tile.vertexArrayID);
-            glBindBuffer(GL_ARRAY_BUFFER, tile.vertexBufferID);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, tile.indexBufferID);
-
-            // Render the tile
-            tile.render(vp);
-        }
+        profiler.beginScope("tiles");
+        profiler.beginGpuPass("tiles");
+        tileRenderer.render(occlusionCulling ? culled.tiles : tiles, frameStream, vp);
         glUseProgram(0); // Unbind the tile shader program
+        profiler.endGpuPass();
+        profiler.endScope();
 
         // Render Buildings
-        glUseProgram(buildingProgramID);
-        for (auto& building : buildings) {
-            glBindVertexArray(building.vaoID);
-            glBindBuffer(GL_ARRAY_BUFFER, building.vboVerticesID);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, building.eboIndicesID);
-
-            // Render the building
-            building.render(vp);
-        }
+        profiler.beginScope("buildings");
+        profiler.beginGpuPass("buildings");
+        if (drawImpostors) {
+            if (!occlusionCulling) {
+                glm::vec2 center(eye.x, eye.z);
+                buildingGrid.query(center - viewDistance, center + viewDistance, lodCandidates);
+            }
+            splitLevelsOfDetail(occlusionCulling ? culled.buildings : lodCandidates, eye, lod);
+            buildingRenderer.renderVisible(lod.meshes, buildings, frameStream, vp);
+        } else if (occlusionCulling)
+            buildingRenderer.renderVisible(culled.buildings, buildings, frameStream, vp);
+        else if (occlusionQueries)
+            buildingRenderer.renderQueried(vp, eye);
+        else
+            buildingRenderer.render(vp);
         glUseProgram(0); // Unbind the building shader program
+        profiler.endGpuPass();
+        profiler.endScope();
+
+        // Render distant buildings as impostors
+        profiler.beginScope("impostors");
+        profiler.beginGpuPass("impostors");
+        if (drawImpostors)
+            impostorRenderer.render(lod.impostors, buildings, frameStream);
+        glUseProgram(0);
+        profiler.endGpuPass();
+        profiler.endScope();
+
+        // Render the Skybox last, only where nothing else was drawn
+        if (!skyFirst) {
+            profiler.beginScope("skybox");
+            profiler.beginGpuPass("skybox");
+            skybox.render(projection, view);
+            glUseProgram(0);
+            profiler.endGpuPass();
+            profiler.endScope();
+        }
 
-        // FPS tracking 
-		// Count number of frames over a few seconds and take average
-		frames++;
-		fTime += deltaTime;
-		if (fTime > 2.0f) {		
-			float fps = frames / fTime;
-			frames = 0;
-			fTime = 0;
-			
-			std::stringstream stream;
-			stream << std::fixed << std::setprecision(2) << "Futuristic Emerald Isle | Frames per second (FPS): " << fps;
-			glfwSetWindowTitle(window, stream.str().c_str());
-		}
+        // Nothing else reads this frame's stream region
+        frameStream.endFrame();
+
+        // FPS tracking
+        // Count number of frames over a few seconds and take average
+        frames++;
+        fTime += deltaTime;
+        worstFrame = std::max(worstFrame, deltaTime);
+        if (fTime > 2.0f) {
+            float fps = frames / fTime;
+            float worstFrameMs = worstFrame * 1000.0f;
+            frames = 0;
+            fTime = 0;
+            worstFrame = 0.0f;
+
+            std::stringstream stream;
+            stream << std::fixed << std::setprecision(2) << "Futuristic Emerald Isle | Frames per second (FPS): " << fps
+                << " | Worst frame (ms): " << worstFrameMs
+                << " | p50/p95/p99 (ms): " << profiler.percentile(50.0f) << "/" << profiler.percentile(95.0f) << "/" << profiler.percentile(99.0f)
+                << " | GPU tiles/buildings/impostors/sky (ms): " << profiler.gpuTime("tiles") << "/" << profiler.gpuTime("buildings")
+                << "/" << profiler.gpuTime("impostors") << "/" << profiler.gpuTime("skybox")
+                << " | GPU shadow cascades (ms): " << profiler.gpuTime(cascadePassNames[0]) << "/" << profiler.gpuTime(cascadePassNames[1])
+                << "/" << profiler.gpuTime(cascadePassNames[2])
+                << " | Sky fragments: " << skybox.visibleSamples
+                << " | Streamed (KB/frame): " << frameStream.lastFrameBytes / 1024.0f
+                << " | Stalls avoided: " << frameStream.stallsAvoided;
+            if (occlusionCulling) {
+                stream << " | Occluded buildings/tiles: " << culled.occludedBuildings << "/" << culled.occludedTiles
+                    << " | Cull (ms): " << occlusionCuller.rasterMs + occlusionCuller.testMs;
+            }
+            if (impostors) {
+                stream << " | Meshes/impostors: " << lod.meshes.size() << "/" << lod.impostors.size();
+            }
+            if (occlusionQueries) {
+                stream << " | Blocks skipped/in view: " << buildingRenderer.blocksSkipped << "/" << buildingRenderer.blocksInView
+                    << " | Unconditional: " << buildingRenderer.blocksUnconditional
+                    << " | Draws: " << buildingRenderer.blockDraws;
+            }
+            glfwSetWindowTitle(window, stream.str().c_str());
+        }
 
         // Swap buffers and poll events
+        profiler.beginScope("swap");
         glfwSwapBuffers(window);
         glfwPollEvents();
-    }
+        profiler.endScope();
 
-        skybox.cleanup(); 
-
-        for (auto& tile : tiles) {
-            tile.cleanup();
-        }
+        // Delete objects released in earlier frames once the GPU has finished them
+        DefaultDeletionQueue().endFrame();
 
-        for (auto& building : buildings) {
-            building.cleanup();
+        if (benchmark.enabled) {
+            // Include the GPU work of this frame in its time
+            glFinish();
+            frameSamples.push_back((glfwGetTime() - frameStart) * 1000.0);
+            generationSamples.push_back(generationTime * 1000.0);
+            benchmarkFrame++;
         }
 
-        glfwTerminate();
-        return 0;
+        profiler.endFrame();
     }
 
-void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
-    if (firstMouse) {
-        lastX = xpos;
-        lastY = ypos;
-        firstMouse = false;
+    if (benchmark.enabled) {
+        BenchmarkReport report;
+        report.add("renderer", std::string((const char *)glGetString(GL_RENDERER)));
+        report.add("context", std::string(benchmark.useOSMesa ? "osmesa" : "egl"));
+        report.add("camera_path", input.replaying() ? benchmark.replayFile : cameraPath.description());
+        report.add("frames", (double)benchmarkFrame);
+        report.add("timestep", benchmark.timestep);
+        report.add("seed", (double)citySeed);
+        report.add("frame_ms", SummarizeSamples(frameSamples));
+        report.add("generation_ms", SummarizeSamples(generationSamples));
+        report.add("texture_upload_ms", SummarizeSamples(textureSamples));
+        report.add("gpu_tiles_ms", profiler.gpuTime("tiles"));
+        report.add("gpu_buildings_ms", profiler.gpuTime("buildings"));
+        report.add("gpu_impostors_ms", profiler.gpuTime("impostors"));
+        report.add("gpu_skybox_ms", profiler.gpuTime("skybox"));
+        report.add("sky_samples", (double)skybox.visibleSamples);
+        report.add("gpu_shadow_cascade0_ms", profiler.gpuTime(cascadePassNames[0]));
+        report.add("gpu_shadow_cascade1_ms", profiler.gpuTime(cascadePassNames[1]));
+        report.add("gpu_shadow_cascade2_ms", profiler.gpuTime(cascadePassNames[2]));
+        report.add("shadow_cascade0_renders", (double)shadowCascades.renders[0]);
+        report.add("shadow_cascade1_renders", (double)shadowCascades.renders[1]);
+        report.add("shadow_cascade2_renders", (double)shadowCascades.renders[2]);
+        report.add("shadow_caster_blocks", (double)buildingRenderer.casterBlocksDrawn);
+        report.add("peak_rss_kb", (double)PeakResidentKB());
+        report.add("texture_bytes", (double)DefaultTextureLoader().bytesUploaded);
+        report.add("stream_bytes_per_frame", benchmarkFrame > 0 ? (double)frameStream.bytesStreamed / benchmarkFrame : 0.0);
+        report.add("stream_stalls_avoided", (double)frameStream.stallsAvoided);
+        report.add("stream_waits", (double)frameStream.waits);
+        report.add("stream_wait_ms", frameStream.waitMs);
+        report.add("stream_persistent", frameStream.persistent() ? 1.0 : 0.0);
+        report.add("tiles", (double)tiles.size());
+        report.add("occlusion", benchmark.occlusion);
+        report.add("textures", benchmark.textures);
+        report.add("sky", benchmark.sky);
+        if (occlusionCulling) {
+            report.add("cull_ms", SummarizeSamples(cullSamples));
+            report.add("occluders", (double)occlusionCuller.occluders);
+            report.add("occluded_buildings", (double)culled.occludedBuildings);
+            report.add("occluded_tiles", (double)culled.occludedTiles);
+            report.add("drawn_buildings", (double)culled.buildings.size());
+            report.add("drawn_tiles", (double)culled.tiles.size());
+        }
+        if (occlusionQueries) {
+            report.add("blocks", (double)buildingRenderer.blocks.size());
+            report.add("blocks_in_view", (double)buildingRenderer.blocksInView);
+            report.add("blocks_skipped", (double)buildingRenderer.blocksSkipped);
+            report.add("blocks_unconditional", (double)buildingRenderer.blocksUnconditional);
+            report.add("block_draws", (double)buildingRenderer.blockDraws);
+        }
+        report.add("view_distance", (double)viewDistance);
+        report.add("impostor_distance", impostors ? (double)impostorDistance : 0.0);
+        if (impostors) {
+            report.add("impostor_bake_ms", impostorRenderer.bakeMs);
+            report.add("drawn_meshes", (double)lod.meshes.size());
+            report.add("drawn_impostors", (double)lod.impostors.size());
+        }
+        report.add("buildings", (double)buildings.size());
+        report.write(benchmark.outFile.c_str());
     }
 
-    float xoffset = xpos - lastX;
-    float yoffset = lastY - ypos;
-    lastX = xpos;
-    lastY = ypos;
-
-    float sensitivity = 0.1f;
-    xoffset *= sensitivity;
-    yoffset *= sensitivity;
-
-    yaw += xoffset;
-    pitch += yoffset;
+    simulation.stop();
+    input.stop();
+    profiler.writeChromeTrace("frame_trace.json");
+    profiler.cleanup();
+
+    // Workers never touch GL, but they must be idle before the process exits
+    chunkWorkers.shutdown();
+
+    skybox.cleanup();
+    tiles.clear();
+    tileRenderer.cleanup();
+    buildingRenderer.cleanup();
+    impostorRenderer.cleanup();
+    shadowCascades.cleanup();
+    frameStream.cleanup();
+    DefaultTextureLoader().shutdown();
+
+    // Everything released above is still queued, delete it while the context exists
+    DefaultDeletionQueue().flush();
+    DefaultAssetPack().close();
+
+    glfwTerminate();
+    return 0;
+}
 
-    if (pitch > 89.0f)
-        pitch = 89.0f;
-    if (pitch < -89.0f)
-        pitch = -89.0f;
+void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
+    input.cursorEvent(xpos, ypos);
+}
 
-    glm::vec3 front;
-    front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-    front.y = sin(glm::radians(pitch));
-    front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-    cameraFront = glm::normalize(front);
+// Turn the camera, for live and replayed cursor positions alike
+void applyMouseMovement(double xpos, double ypos) {
+    flyCamera.look(xpos, ypos);
 }
 
-//for debugging
-/*
-void handleCameraMovement(GLFWwindow* window) {
-    glm::vec3 direction(0.0f);
-
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        direction += cameraFront;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        direction -= cameraFront;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        direction -= glm::normalize(glm::cross(cameraFront, cameraUp));
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        direction += glm::normalize(glm::cross(cameraFront, cameraUp));
-
-    if (glm::length(direction) > 0.0f)
-        cameraPos += glm::normalize(direction) * cameraSpeed;
-
-    // Update Skybox position to follow the camera
-    skybox.position = cameraPos;
+// Place the camera where the benchmark path is at the given simulated time
+void followCameraPath(const CameraPath& path, double time) {
+    path.sample(time, flyCamera.position, flyCamera.yaw, flyCamera.pitch);
+    flyCamera.front = CameraFront(flyCamera.yaw, flyCamera.pitch);
 }
-*/
-
-// for user
-void handleCameraMovement(GLFWwindow* window) {
-    glm::vec3 direction(0.0f);
-
-    // Handle keyboard input for movement
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        direction += cameraFront;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        direction -= cameraFront;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        direction -= glm::normalize(glm::cross(cameraFront, cameraUp));
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        direction += glm::normalize(glm::cross(cameraFront, cameraUp));
+
+// for user: one simulation tick of movement
+void handleCameraMovement(double tickSeconds) {
+    // Handle keyboard input for movement, live or replayed
+    glm::vec3 direction = flyCamera.moveDirection(input.isKeyDown(GLFW_KEY_W), input.isKeyDown(GLFW_KEY_S),
+        input.isKeyDown(GLFW_KEY_A), input.isKeyDown(GLFW_KEY_D));
 
     if (glm::length(direction) > 0.0f) {
-        glm::vec3 proposedPosition = cameraPos + glm::normalize(direction) * cameraSpeed;
+        glm::vec3 proposedPosition = flyCamera.position + direction * (flyCamera.speed * (float)tickSeconds);
 
         // Preserve the camera's fixed y-coordinate
-        proposedPosition.y = cameraPos.y;
-
-        // Check for collisions with buildings
-        bool collision = false;
-        for (const auto& building : buildings) {
-            if (building.isPointInside(proposedPosition)) {
-                collision = true;
-                break;
+        proposedPosition.y = flyCamera.position.y;
+
+        // Stop at buildings in the way and slide along their walls
+        flyCamera.position = collideCamera(flyCamera.position, proposedPosition);
+    }
+}
+
+// Move a sphere around the camera from start towards end, stopping where it would touch a building
+// and sliding the remaining motion along the wall. Only buildings in the tiles under the motion are
+// tested, so the cost does not grow with the size of the city.
+glm::vec3 collideCamera(glm::vec3 start, glm::vec3 end) {
+    const float cameraRadius = 0.5f;   // Clearance kept from the walls
+    const float skin = 0.001f;         // Gap kept from the wall so the next sweep starts outside
+
+    std::lock_guard<std::mutex> lock(buildingsMutex);
+    std::vector<uint32_t> nearby;
+
+    // A slide can run into a second wall, e.g. in a corner, after that give up
+    for (int iteration = 0; iteration < 3; ++iteration) {
+        glm::vec3 motion = end - start;
+        float distance = glm::length(motion);
+        if (distance < 1e-6f)
+            break;
+
+        glm::vec3 lo = glm::min(start, end) - glm::vec3(cameraRadius);
+        glm::vec3 hi = glm::max(start, end) + glm::vec3(cameraRadius);
+        buildingGrid.query(glm::vec2(lo.x, lo.z), glm::vec2(hi.x, hi.z), nearby);
+
+        float firstHit = 1.0f;
+        glm::vec3 firstNormal(0.0f);
+        for (uint32_t index : nearby) {
+            float hit;
+            glm::vec3 normal;
+            if (SweepSphereBox(start, end, cameraRadius, buildings.positions[index], buildings.halfExtents[index], hit, normal)
+                && hit < firstHit) {
+                firstHit = hit;
+                firstNormal = normal;
             }
         }
 
-        // Update camera position only if no collision
-        if (!collision) {
-            cameraPos = proposedPosition;
+        if (firstHit >= 1.0f)
+            return end;
 
-            // Update Skybox position to follow the camera
-            skybox.position = cameraPos;
-        }
+        // Advance to the contact point, then keep only the part of the motion along the wall
+        start += motion * std::max(0.0f, firstHit - skin / distance);
+        glm::vec3 remaining = end - start;
+        end = start + remaining - firstNormal * glm::dot(remaining, firstNormal);
     }
+    return start;
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    input.keyEvent(key, action);
+
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, GL_TRUE);
 }
@@ -2,7 +2,8 @@
 #include <GLFW/glfw3.h>      // GLFW for window and input management
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <render/shader.h>
+#include "scenewindow.h"
+#include "shader.h"
 #include <iostream>          // For console output
 
 
@@ -24,40 +25,14 @@ static float viewDistance = 500.0f;
 
 
 int main() {
-    // Initialise GLFW
-	if (!glfwInit())
-	{
-		std::cerr << "Failed to initialize GLFW." << std::endl;
-		return -1;
-	}
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // For MacOS
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    // Open a window and create its OpenGL context
-	window = glfwCreateWindow(windowWidth, windowHeight, "Creating Window", NULL, NULL);
+	SceneWindowOptions options;
+	options.width = windowWidth;
+	options.height = windowHeight;
+	window = CreateSceneWindow("Creating Window", options);
 	if (window == NULL)
-	{
-		std::cerr << "Failed to open a GLFW window." << std::endl;
-		glfwTerminate();
 		return -1;
-	}
-	glfwMakeContextCurrent(window);
-
-    // Ensure we can capture the escape key being pressed below
-	glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
 	glfwSetKeyCallback(window, key_callback);
 
-	// Load OpenGL functions, gladLoadGL returns the loaded version, 0 on error.
-	int version = gladLoadGL(glfwGetProcAddress);
-	if (version == 0)
-	{
-		std::cerr << "Failed to initialize OpenGL context." << std::endl;
-		return -1;
-	}
-
 	// Background
 	glClearColor(0.53f, 0.81f, 0.92f, 1.0f);
 
@@ -3,12 +3,17 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "scenewindow.h"
+#include "flycamera.h"
 #define STB_PERLIN_IMPLEMENTATION
 #include "stb_perlin.h"
 #include <vector>
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
@@ -16,13 +21,9 @@ static GLFWwindow *window;
 static int windowWidth = 1024;
 static int windowHeight = 768;
 
-// Camera
-static glm::vec3 cameraPos(0.0f, 10.0f, 0.0f);
-static glm::vec3 cameraFront(0.0f, 0.0f, -1.0f);
-static glm::vec3 cameraUp(0.0f, 1.0f, 0.0f);
-static float yaw = -90.0f;
-static float pitch = 0.0f;
-static float cameraSpeed = 75.0f; // Adjust as necessary
+// Camera, its speed is set every frame from cameraSpeed and the frame time
+static FlyCamera camera(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), -90.0f, 0.0f, 0.0f);
+static const float cameraSpeed = 75.0f; // Units per second
 static float deltaTime = 0.0f;
 static float lastFrame = 0.0f;
 
@@ -33,46 +34,34 @@ static float frameTime = 0.0f;
 // Terrain grid parameters
 static const int gridSize = 100;
 static const float tileSize = 1.0f;
+static const int gridSide = gridSize * 2 + 1; // Vertices along each edge of the grid
+
+// The grid is a window of the lattice that follows the camera. The mesh only holds each vertex's
+// offset from the window's corner; heights live in a separate buffer in a wraparound layout,
+// lattice point (x, z) in slot (x mod gridSide, z mod gridSide), so a point keeps its slot while
+// it stays in the window. Moving the window writes only the rows and columns that scroll in.
+GLuint gridVAO, gridVBO, gridEBO;
+GLuint heightBuffer, heightTexture;
+static int gridOriginX = 0; // Lattice point at the window's corner
+static int gridOriginZ = 0;
+static bool gridFilled = false;
+static long heightsWritten = 0; // Heights computed and uploaded by the last scroll
 
-GLuint gridVAO, gridVBO;
-
-static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mode);
 void generateGrid();
+void scrollGrid(const glm::vec3 &position);
 void renderGrid(const glm::mat4 &viewProjMatrix, GLuint programID);
 void setupShaders(GLuint &programID);
 void renderText(float frameRate);
 
 int main(void) {
-    // Initialize GLFW
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW." << std::endl;
-        return -1;
-    }
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // For MacOS
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    // Open a window and create its OpenGL context
-    window = glfwCreateWindow(windowWidth, windowHeight, "Infinite Grid", NULL, NULL);
-    if (window == NULL) {
-        std::cerr << "Failed to open a GLFW window." << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-
-    // Capture escape key
-    glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
-    glfwSetKeyCallback(window, key_callback);
-
-    // Load OpenGL functions, gladLoadGL returns the loaded version, 0 on error.
-    int version = gladLoadGL(glfwGetProcAddress);
-    if (version == 0) {
-        std::cerr << "Failed to initialize OpenGL context." << std::endl;
+    SceneWindowOptions options;
+    options.width = windowWidth;
+    options.height = windowHeight;
+    options.captureCursor = true;
+    window = CreateSceneWindow("Infinite Grid", options);
+    if (window == NULL)
         return -1;
-    }
+    AttachFlyCamera(window, &camera);
 
     // Setup OpenGL
     glEnable(GL_DEPTH_TEST);
@@ -98,11 +87,18 @@ int main(void) {
         // Calculate frame rate
         frameRate = 1.0f / deltaTime;
 
+        // Move the camera along the held WASD keys
+        camera.speed = cameraSpeed * deltaTime;
+        camera.move(window);
+
         // Clear buffers
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        // Bring the grid window under the camera
+        scrollGrid(camera.position);
+
         // View matrix
-        glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+        glm::mat4 view = camera.view();
         glm::mat4 viewProj = projection * view;
 
         // Render the grid
@@ -119,6 +115,9 @@ int main(void) {
     // Cleanup
     glDeleteVertexArrays(1, &gridVAO);
     glDeleteBuffers(1, &gridVBO);
+    glDeleteBuffers(1, &gridEBO);
+    glDeleteTextures(1, &heightTexture);
+    glDeleteBuffers(1, &heightBuffer);
     glDeleteProgram(programID);
 
     glfwTerminate();
@@ -129,27 +128,18 @@ void generateGrid() {
     std::vector<float> vertices;
     std::vector<unsigned int> indices;
 
-    for (int z = -gridSize; z <= gridSize; ++z) {
-        for (int x = -gridSize; x <= gridSize; ++x) {
-            float xPos = x * tileSize;
-            float zPos = z * tileSize;
-
-            vertices.push_back(xPos);
-            float yPos = stb_perlin_noise3(x * 0.1f, 0.0f, z * 0.1f, 0, 0, 0) * 2.0f; // Adjust scaling and amplitude
-            vertices.push_back(yPos);
-            vertices.push_back(zPos);
-
-            // Add texture coordinates
-            vertices.push_back((float)(x + gridSize) / (gridSize * 2));
-            vertices.push_back((float)(z + gridSize) / (gridSize * 2));
+    for (int z = 0; z < gridSide; ++z) {
+        for (int x = 0; x < gridSide; ++x) {
+            vertices.push_back((float)x);
+            vertices.push_back((float)z);
         }
     }
 
     for (int z = 0; z < gridSize * 2; ++z) {
         for (int x = 0; x < gridSize * 2; ++x) {
-            unsigned int topLeft = z * (gridSize * 2 + 1) + x;
+            unsigned int topLeft = z * gridSide + x;
             unsigned int topRight = topLeft + 1;
-            unsigned int bottomLeft = (z + 1) * (gridSize * 2 + 1) + x;
+            unsigned int bottomLeft = (z + 1) * gridSide + x;
             unsigned int bottomRight = bottomLeft + 1;
 
             indices.push_back(topLeft);
@@ -164,25 +154,94 @@ void generateGrid() {
 
     glGenVertexArrays(1, &gridVAO);
     glGenBuffers(1, &gridVBO);
+    glGenBuffers(1, &gridEBO);
 
     glBindVertexArray(gridVAO);
 
-    GLuint gridEBO;
-    glGenBuffers(1, &gridEBO);
-
     glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridEBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
     glBindVertexArray(0);
+
+    // Heights are read in the vertex shader through a buffer texture
+    glGenBuffers(1, &heightBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, heightBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, gridSide * gridSide * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+
+    glGenTextures(1, &heightTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, heightTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, heightBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+static float terrainHeight(int x, int z) {
+    return stb_perlin_noise3(x * 0.1f, 0.0f, z * 0.1f, 0, 0, 0) * 2.0f; // Adjust scaling and amplitude
+}
+
+static int heightSlot(int coordinate) {
+    return ((coordinate % gridSide) + gridSide) % gridSide;
+}
+
+// Compute lattice points firstX..firstX + count - 1 of lattice row z and write them to their
+// slots. The slots are contiguous apart from where the run wraps past the end of the row.
+static void writeHeights(int firstX, int count, int z) {
+    static std::vector<float> heights;
+    heights.resize(count);
+    for (int i = 0; i < count; ++i)
+        heights[i] = terrainHeight(firstX + i, z);
+
+    int rowStart = heightSlot(z) * gridSide;
+    int slot = heightSlot(firstX);
+    int firstRun = std::min(count, gridSide - slot);
+    glBufferSubData(GL_TEXTURE_BUFFER, (rowStart + slot) * sizeof(float), firstRun * sizeof(float), heights.data());
+    if (firstRun < count)
+        glBufferSubData(GL_TEXTURE_BUFFER, rowStart * sizeof(float), (count - firstRun) * sizeof(float), heights.data() + firstRun);
+    heightsWritten += count;
+}
+
+void scrollGrid(const glm::vec3 &position) {
+    int originX = (int)std::floor(position.x / tileSize + 0.5f) - gridSize;
+    int originZ = (int)std::floor(position.z / tileSize + 0.5f) - gridSize;
+    int dx = originX - gridOriginX;
+    int dz = originZ - gridOriginZ;
+
+    heightsWritten = 0;
+    if (gridFilled && dx == 0 && dz == 0)
+        return;
+
+    glBindBuffer(GL_TEXTURE_BUFFER, heightBuffer);
+    if (!gridFilled || std::abs(dx) >= gridSide || std::abs(dz) >= gridSide) {
+        // Nothing of the old window survives, refill every row
+        gridOriginX = originX;
+        gridOriginZ = originZ;
+        for (int z = originZ; z < originZ + gridSide; ++z)
+            writeHeights(originX, gridSide, z);
+        gridFilled = true;
+    } else {
+        // Columns that scroll in, for the rows the window covers before it moves along z
+        gridOriginX = originX;
+        if (dx != 0) {
+            int firstX = dx > 0 ? originX + gridSide - dx : originX;
+            for (int z = gridOriginZ; z < gridOriginZ + gridSide; ++z)
+                writeHeights(firstX, std::abs(dx), z);
+        }
+
+        // Then whole rows that scroll in, at the new columns
+        gridOriginZ = originZ;
+        if (dz != 0) {
+            int firstZ = dz > 0 ? originZ + gridSide - dz : originZ;
+            for (int z = firstZ; z < firstZ + std::abs(dz); ++z)
+                writeHeights(originX, gridSide, z);
+        }
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
 }
 
 void renderGrid(const glm::mat4 &viewProjMatrix, GLuint programID) {
@@ -190,6 +249,13 @@ void renderGrid(const glm::mat4 &viewProjMatrix, GLuint programID) {
 
     GLuint matrixID = glGetUniformLocation(programID, "viewProj");
     glUniformMatrix4fv(matrixID, 1, GL_FALSE, &viewProjMatrix[0][0]);
+    glUniform2i(glGetUniformLocation(programID, "gridOrigin"), gridOriginX, gridOriginZ);
+    glUniform2i(glGetUniformLocation(programID, "originSlot"), heightSlot(gridOriginX), heightSlot(gridOriginZ));
+
+    // Unit 0 is left to ourTexture
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, heightTexture);
+    glActiveTexture(GL_TEXTURE0);
 
     glBindVertexArray(gridVAO);
     glDrawElements(GL_TRIANGLES, (gridSize * 2) * (gridSize * 2) * 6, GL_UNSIGNED_INT, 0);
@@ -198,7 +264,7 @@ void renderGrid(const glm::mat4 &viewProjMatrix, GLuint programID) {
 
 void renderText(float frameRate) {
     std::ostringstream ss;
-    ss << "FPS: " << frameRate;
+    ss << "FPS: " << frameRate << "  heights written: " << heightsWritten;
     std::string text = ss.str();
 
     // For simplicity, we use the GLFW window title to display FPS
@@ -208,13 +274,21 @@ void renderText(float frameRate) {
 void setupShaders(GLuint &programID) {
     const char *vertexShaderSource = R"(
         #version 330 core
-        layout(location = 0) in vec3 aPos;
-        layout(location = 1) in vec2 aTexCoords;
+        layout(location = 0) in vec2 aGridPos; // Offset from the window's corner, in lattice steps
         uniform mat4 viewProj;
+        uniform ivec2 gridOrigin;
+        uniform ivec2 originSlot;
+        uniform int gridSide;
+        uniform float tileSize;
+        uniform samplerBuffer heights;
         out vec2 TexCoords;
         void main() {
-            gl_Position = viewProj * vec4(aPos, 1.0);
-            TexCoords = aTexCoords;
+            ivec2 offset = ivec2(aGridPos);
+            ivec2 slot = (originSlot + offset) % gridSide;
+            float height = texelFetch(heights, slot.y * gridSide + slot.x).r;
+            vec2 lattice = vec2(gridOrigin + offset);
+            gl_Position = viewProj * vec4(lattice.x * tileSize, height, lattice.y * tileSize, 1.0);
+            TexCoords = lattice / float(gridSide - 1);
         }
     )";
 
@@ -245,24 +319,9 @@ void setupShaders(GLuint &programID) {
     glLinkProgram(programID);
 
     glUseProgram(programID);
+    glUniform1i(glGetUniformLocation(programID, "gridSide"), gridSide);
+    glUniform1f(glGetUniformLocation(programID, "tileSize"), tileSize);
+    glUniform1i(glGetUniformLocation(programID, "heights"), 1);
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 }
-
-void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode) {
-    // Exit application on pressing ESC
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
-
-    // Camera controls
-    float cameraSpeedDelta = cameraSpeed * deltaTime;
-    if (key == GLFW_KEY_W && (action == GLFW_PRESS || action == GLFW_REPEAT))
-        cameraPos += cameraSpeedDelta * cameraFront;
-    if (key == GLFW_KEY_S && (action == GLFW_PRESS || action == GLFW_REPEAT))
-        cameraPos -= cameraSpeedDelta * cameraFront;
-    if (key == GLFW_KEY_A && (action == GLFW_PRESS || action == GLFW_REPEAT))
-        cameraPos -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeedDelta;
-    if (key == GLFW_KEY_D && (action == GLFW_PRESS || action == GLFW_REPEAT))
-        cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeedDelta;
-}
-
@@ -2,8 +2,12 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "scenewindow.h"
 
-#include <render/shader.h>
+#include "shader.h"
+#include "glresource.h"
+#include "streambuffer.h"
+#include "tilerenderer.h"
 
 #include <vector>
 #include <iostream>
@@ -21,182 +25,27 @@ static float viewAzimuth = 0.f;
 static float viewPolar = 25.0f;
 static float viewDistance = 500.0f;
 
-
-
-struct Tile {
-    float tileVertices[18] = {
-        -0.5f, 0.0f, -0.5f, // Bottom-left
-        0.5f, 0.0f, -0.5f,  // Bottom-right
-        -0.5f, 0.0f,  0.5f, // Top-left
-
-        0.5f, 0.0f, -0.5f,  // Bottom-right
-        0.5f, 0.0f,  0.5f,  // Top-right
-        -0.5f, 0.0f,  0.5f  // Top-left
-    };
-
-    float tileColors[18] = {
-        0.1f, 0.3f, 0.2f, // Bottom-left
-        0.1f, 0.3f, 0.2f, // Bottom-right
-        0.1f, 0.3f, 0.2f, // Top-left
-
-        0.1f, 0.3f, 0.2f, // Bottom-right
-        0.1f, 0.3f, 0.2f, // Top-right
-        0.1f, 0.3f, 0.2f  // Top-left
-    };
-
-    GLuint vertexArrayID;
-    GLuint vertexBufferID;
-    GLuint colorBufferID;
-    GLuint programID;
-    GLuint mvpMatrixID;
-
-    const char* vertexShaderSource = R"(
-    #version 330 core
-    layout(location = 0) in vec3 aPos;
-    layout(location = 1) in vec3 aColor;
-
-    uniform mat4 MVP;
-
-    out vec3 vertexColor;
-
-    void main() {
-        gl_Position = MVP * vec4(aPos, 1.0);
-        vertexColor = aColor;
-    }
-    )";
-
-    const char* fragmentShaderSource = R"(
-    #version 330 core
-    in vec3 vertexColor;
-    out vec4 FragColor;
-
-    void main() {
-        FragColor = vec4(vertexColor, 1.0);
-    }
-    )";
-
-    GLuint compileShader(GLenum type, const char* source) {
-        GLuint shader = glCreateShader(type);
-        glShaderSource(shader, 1, &source, NULL);
-        glCompileShader(shader);
-
-        int success;
-        char infoLog[512];
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(shader, 512, NULL, infoLog);
-            std::cerr << "Shader Compilation Error: " << infoLog << std::endl;
-        }
-
-        return shader;
-    }
-
-    void initialize() {
-        glGenVertexArrays(1, &vertexArrayID);
-        glBindVertexArray(vertexArrayID);
-
-        glGenBuffers(1, &vertexBufferID);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(tileVertices), tileVertices, GL_STATIC_DRAW);
-
-        glGenBuffers(1, &colorBufferID);
-        glBindBuffer(GL_ARRAY_BUFFER, colorBufferID);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(tileColors), tileColors, GL_STATIC_DRAW);
-
-        GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
-        GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-
-        programID = glCreateProgram();
-        glAttachShader(programID, vertexShader);
-        glAttachShader(programID, fragmentShader);
-        glLinkProgram(programID);
-
-        int success;
-        char infoLog[512];
-        glGetProgramiv(programID, GL_LINK_STATUS, &success);
-        if (!success) {
-            glGetProgramInfoLog(programID, 512, NULL, infoLog);
-            std::cerr << "Program Linking Error: " << infoLog << std::endl;
-        }
-
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-
-        mvpMatrixID = glGetUniformLocation(programID, "MVP");
-    }
-
-    void render(glm::mat4 cameraMatrix) {
-        glUseProgram(programID);
-
-        glBindVertexArray(vertexArrayID);
-
-        glEnableVertexAttribArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-        glEnableVertexAttribArray(1);
-        glBindBuffer(GL_ARRAY_BUFFER, colorBufferID);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-        glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &cameraMatrix[0][0]);
-
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        glDisableVertexAttribArray(0);
-        glDisableVertexAttribArray(1);
-
-        glBindVertexArray(0);
-    }
-
-    void cleanup() {
-        glDeleteBuffers(1, &vertexBufferID);
-        glDeleteBuffers(1, &colorBufferID);
-        glDeleteVertexArrays(1, &vertexArrayID);
-        glDeleteProgram(programID);
-    }
-};
+static const glm::vec3 tileColor = glm::vec3(0.1f, 0.3f, 0.2f);
 
 int main() {
 
-    // Initialise GLFW
-	if (!glfwInit())
-	{
-		std::cerr << "Failed to initialize GLFW." << std::endl;
-		return -1;
-	}
-
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // For MacOS
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	// Open a window and create its OpenGL context
-	window = glfwCreateWindow(1024, 768, "Lab 2", NULL, NULL);
+	window = CreateSceneWindow("Lab 2");
 	if (window == NULL)
-	{
-		std::cerr << "Failed to open a GLFW window." << std::endl;
-		glfwTerminate();
 		return -1;
-	}
-	glfwMakeContextCurrent(window);
-
-	// Ensure we can capture the escape key being pressed below
-	glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
 	glfwSetKeyCallback(window, key_callback);
 
-	// Load OpenGL functions, gladLoadGL returns the loaded version, 0 on error.
-	int version = gladLoadGL(glfwGetProcAddress);
-	if (version == 0)
-	{
-		std::cerr << "Failed to initialize OpenGL context." << std::endl;
-		return -1;
-	}
-
     glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
     glEnable(GL_DEPTH_TEST);
 
-    Tile tile;
-    tile.initialize();
+    // One unit tile at the origin
+    std::vector<Tile> tiles(1, Tile(glm::vec3(0.0f), 1.0f));
+    StreamBuffer frameStream(4 * 1024);
+    frameStream.initialize(glfwGetProcAddress);
+    TileRenderer tileRenderer;
+    tileRenderer.initialize("../FinalProject/flat_tile.vert", "../FinalProject/flat_tile_color.frag");
+    glUseProgram(tileRenderer.programID());
+    glUniform3fv(glGetUniformLocation(tileRenderer.programID(), "tileColor"), 1, &tileColor[0]);
+    glUseProgram(0);
 
     glm::mat4 view = glm::lookAt(eye_center, lookat, up);
     glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1024.0f / 768.0f, 0.1f, 100.0f);
@@ -205,13 +54,20 @@ int main() {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         glm::mat4 vp = projection * view;
-        tile.render(vp);
+        frameStream.beginFrame();
+        tileRenderer.render(tiles, frameStream, vp);
+        frameStream.endFrame();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
-    tile.cleanup();
+    tileRenderer.cleanup();
+    frameStream.cleanup();
+
+    // Everything released above is still queued, delete it while the context exists
+    DefaultDeletionQueue().flush();
+
     glfwTerminate();
 
     return 0;
@@ -3,331 +3,105 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "scenewindow.h"
+#include "flycamera.h"
+#include "chunkstreamer.h"
+#include "textureloader.h"
+#include "glresource.h"
+#include "streambuffer.h"
+#include "tilerenderer.h"
 
 #include <vector>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <string>
 #include <tuple>
 #include <unordered_set>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb/stb_image.h>
-
-void handleCameraMovement(GLFWwindow* window);
-void mouse_callback(GLFWwindow* window, double xpos, double ypos);
-void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
-
-
-
-
 static GLFWwindow *window;
 static int windowWidth = 1024;
 static int windowHeight = 768;
 
 // Camera variables
-static glm::vec3 cameraPos(0.0f, 1.0f, 3.0f);
-static glm::vec3 cameraFront(0.0f, 0.0f, -1.0f);
-static glm::vec3 cameraUp(0.0f, 1.0f, 0.0f);
-static float yaw = -90.0f;
-static float pitch = 0.0f;
-static float lastX = windowWidth / 2.0f;
-static float lastY = windowHeight / 2.0f;
-static bool firstMouse = true;
-static float cameraSpeed = 0.05f;
+static FlyCamera camera(glm::vec3(0.0f, 1.0f, 3.0f), glm::vec3(0.0f, 0.0f, -1.0f), -90.0f, 0.0f, 0.05f);
 
 static const float cellSize = 10.0f;
 static const int renderDistance = 5;
 
-const char* vertexShaderSource = R"(
-#version 330 core
-
-layout(location = 0) in vec3 aPos;       // Vertex position
-layout(location = 1) in vec2 aTexCoord; // Texture coordinates
-
-uniform mat4 MVP;
-
-out vec2 TexCoord; // Pass texture coordinates to fragment shader
-
-void main() {
-    gl_Position = MVP * vec4(aPos, 1.0);
-    TexCoord = aTexCoord;
-}
-)";
-
-const char* fragmentShaderSource = R"(
-#version 330 core
-
-in vec2 TexCoord;
-out vec4 FragColor;
-
-uniform sampler2D texture1;
-
-void main() {
-    FragColor = texture(texture1, TexCoord);
-}
-)";
-
-GLuint LoadTexture(const char* path) {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
-    if (data) {
-        GLenum format = (nrChannels == 4) ? GL_RGBA : GL_RGB;
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    }
-    else {
-        std::cerr << "Failed to load texture" << std::endl;
-    }
-    stbi_image_free(data);
-
-    return textureID;
-}
-
-struct Tile {
-    float tileVertices[20] = {
-        -0.5f, 0.0f, -0.5f,  0.0f, 0.0f,
-         0.5f, 0.0f, -0.5f,  1.0f, 0.0f,
-         0.5f, 0.0f,  0.5f,  1.0f, 1.0f,
-        -0.5f, 0.0f,  0.5f,  0.0f, 1.0f
-    };
-
-    unsigned int tileIndices[6] = {
-        0, 1, 2,
-        0, 2, 3
-    };
-
-    GLuint vertexArrayID;
-    GLuint vertexBufferID;
-    GLuint indexBufferID;
-    GLuint textureID;
-    GLuint programID;
-    GLuint mvpMatrixID;
-
-    glm::vec3 position;
-    float scale;
-
-    Tile(glm::vec3 pos, float size) : position(pos), scale(size) {}
-
-    GLuint compileShader(GLenum type, const char* source) {
-        GLuint shader = glCreateShader(type);
-        glShaderSource(shader, 1, &source, NULL);
-        glCompileShader(shader);
-
-        int success;
-        char infoLog[512];
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(shader, 512, NULL, infoLog);
-            std::cerr << "Shader Compilation Error: " << infoLog << std::endl;
-        }
-
-        return shader;
-    }
-
-    void initialize(const std::string& textureFilePath, const char* vertexShaderSource, const char* fragmentShaderSource) {
-        glGenVertexArrays(1, &vertexArrayID);
-        glBindVertexArray(vertexArrayID);
-
-        glGenBuffers(1, &vertexBufferID);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(tileVertices), tileVertices, GL_STATIC_DRAW);
-
-        glGenBuffers(1, &indexBufferID);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(tileIndices), tileIndices, GL_STATIC_DRAW);
-
-        textureID = LoadTexture(textureFilePath.c_str());
-
-        GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
-        GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-
-        programID = glCreateProgram();
-        glAttachShader(programID, vertexShader);
-        glAttachShader(programID, fragmentShader);
-        glLinkProgram(programID);
-
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-
-        mvpMatrixID = glGetUniformLocation(programID, "MVP");
-    }
-
-    void render(glm::mat4 viewProjection) {
-        glUseProgram(programID);
-
-        glBindVertexArray(vertexArrayID);
-
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glUniform1i(glGetUniformLocation(programID, "texture1"), 0);
-
-        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
-        model = glm::scale(model, glm::vec3(scale));
-        glm::mat4 mvp = viewProjection * model;
-        glUniformMatrix4fv(mvpMatrixID, 1, GL_FALSE, &mvp[0][0]);
-
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-        glBindVertexArray(0);
-    }
-
-    void cleanup() {
-        glDeleteBuffers(1, &vertexBufferID);
-        glDeleteBuffers(1, &indexBufferID);
-        glDeleteVertexArrays(1, &vertexArrayID);
-        glDeleteTextures(1, &textureID);
-        glDeleteProgram(programID);
-    }
-};
-
 std::vector<Tile> tiles;
+TileRenderer tileRenderer;
+
+// Tile records, rewritten every frame without waiting on the GPU
+StreamBuffer frameStream(1024 * 1024);
+
+// Tiles cover the cells within renderDistance, the streamer reports the cells that came into range
+// and those that went out of it
+ChunkStreamer tileStreamer(cellSize, renderDistance);
+
+void generateTiles(const std::vector<ChunkCoord>& cells, const std::vector<ChunkCoord>& left) {
+    // Drop the tiles of the cells out of range, each tile sits at its cell times cellSize
+    if (!left.empty()) {
+        std::unordered_set<ChunkCoord, TupleHash> leftCells(left.begin(), left.end());
+        tiles.erase(std::remove_if(tiles.begin(), tiles.end(), [&](const Tile& tile) {
+            ChunkCoord cell((int)std::lround(tile.position.x / cellSize), (int)std::lround(tile.position.z / cellSize));
+            return leftCells.count(cell) != 0;
+        }), tiles.end());
+    }
 
-void generateTiles(glm::vec3 position, const char* vertexShaderSource, const char* fragmentShaderSource) {
-    int centerX = static_cast<int>(std::floor(position.x / cellSize));
-    int centerZ = static_cast<int>(std::floor(position.z / cellSize));
-
-    for (int x = centerX - renderDistance; x <= centerX + renderDistance; ++x) {
-        for (int z = centerZ - renderDistance; z <= centerZ + renderDistance; ++z) {
-            glm::vec3 tilePosition = glm::vec3(x * cellSize, 0.0f, z * cellSize);
-            if (std::none_of(tiles.begin(), tiles.end(), [&](const Tile& t) {
-                return t.position == tilePosition;
-            })) {
-                Tile newTile(tilePosition, cellSize);
-                newTile.initialize("../FinalProject/floor_texture.jpg", vertexShaderSource, fragmentShaderSource);
-                tiles.push_back(newTile);
-            }
-        }
+    for (const ChunkCoord& cell : cells) {
+        glm::vec3 tilePosition = glm::vec3(std::get<0>(cell) * cellSize, 0.0f, std::get<1>(cell) * cellSize);
+        tiles.push_back(Tile(tilePosition, cellSize));
     }
 }
 
 
 int main() {
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW." << std::endl;
-        return -1;
-    }
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    window = glfwCreateWindow(windowWidth, windowHeight, "Textured Infinite Scene", NULL, NULL);
-    if (window == NULL) {
-        std::cerr << "Failed to open a GLFW window." << std::endl;
-        glfwTerminate();
+    SceneWindowOptions options;
+    options.captureCursor = true;
+    window = CreateSceneWindow("Textured Infinite Scene", options);
+    if (window == NULL)
         return -1;
-    }
-    glfwMakeContextCurrent(window);
-
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetKeyCallback(window, key_callback);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    if (!gladLoadGL(glfwGetProcAddress)) {
-        std::cerr << "Failed to initialize GLAD" << std::endl;
-        return -1;
-    }
+    AttachFlyCamera(window, &camera);
 
     glClearColor(0.53f, 0.81f, 0.92f, 1.0f);
     glEnable(GL_DEPTH_TEST);
 
-    generateTiles(cameraPos, vertexShaderSource, fragmentShaderSource);
+    frameStream.initialize(glfwGetProcAddress);
+    tileRenderer.initialize("../FinalProject/flat_tile.vert", "../FinalProject/flat_tile_textured.frag", "../FinalProject/floor_texture.jpg");
+
+    std::vector<ChunkCoord> entered, left;
 
     while (!glfwWindowShouldClose(window)) {
-        handleCameraMovement(window);
+        camera.move(window);
 
-        static glm::vec3 lastCameraPos = cameraPos;
-        if (glm::distance(lastCameraPos, cameraPos) > 1.0f) {
-            generateTiles(cameraPos, vertexShaderSource, fragmentShaderSource);
-            lastCameraPos = cameraPos;
+        if (tileStreamer.update(camera.position, entered, left)) {
+            generateTiles(entered, left);
         }
+        DefaultTextureLoader().update(0.002);
 
-        glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+        glm::mat4 view = camera.view();
         glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)windowWidth / windowHeight, 0.1f, 100.0f);
         glm::mat4 vp = projection * view;
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        for (auto& tile : tiles) {
-            tile.render(vp);
-        }
+        frameStream.beginFrame();
+        tileRenderer.render(tiles, frameStream, vp);
+        frameStream.endFrame();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
-    for (auto& tile : tiles) {
-        tile.cleanup();
-    }
+    tiles.clear();
+    tileRenderer.cleanup();
+    frameStream.cleanup();
+    DefaultTextureLoader().shutdown();
+
+    // Everything released above is still queued, delete it while the context exists
+    DefaultDeletionQueue().flush();
 
     glfwTerminate();
     return 0;
 }
-
-
-void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
-    if (firstMouse) {
-        lastX = xpos;
-        lastY = ypos;
-        firstMouse = false;
-    }
-
-    float xoffset = xpos - lastX;
-    float yoffset = lastY - ypos;
-    lastX = xpos;
-    lastY = ypos;
-
-    float sensitivity = 0.1f;
-    xoffset *= sensitivity;
-    yoffset *= sensitivity;
-
-    yaw += xoffset;
-    pitch += yoffset;
-
-    if (pitch > 89.0f)
-        pitch = 89.0f;
-    if (pitch < -89.0f)
-        pitch = -89.0f;
-
-    glm::vec3 front;
-    front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-    front.y = sin(glm::radians(pitch));
-    front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-    cameraFront = glm::normalize(front);
-}
-
-void handleCameraMovement(GLFWwindow* window) {
-    glm::vec3 direction(0.0f);
-
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        direction += cameraFront;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        direction -= cameraFront;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        direction -= glm::normalize(glm::cross(cameraFront, cameraUp));
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        direction += glm::normalize(glm::cross(cameraFront, cameraUp));
-
-    if (glm::length(direction) > 0.0f)
-        cameraPos += glm::normalize(direction) * cameraSpeed;
-}
-
-void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, GL_TRUE);
-}
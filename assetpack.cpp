@@ -0,0 +1,137 @@
+#include "assetpack.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+AssetPack::~AssetPack()
+{
+	close();
+}
+
+bool AssetPack::open(const char *pack_file_path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(pack_file_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		CloseHandle(file);
+		return false;
+	}
+
+	base = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	size = (size_t)fileSize.QuadPart;
+	fileHandle = file;
+	mappingHandle = mapping;
+	if (!base) {
+		close();
+		return false;
+	}
+#else
+	int fd = ::open(pack_file_path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void *mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file alive, the descriptor is no longer needed
+	::close(fd);
+	if (mapping == MAP_FAILED)
+		return false;
+
+	base = (const unsigned char *)mapping;
+	size = (size_t)info.st_size;
+#endif
+
+	// Validate the header and build the name index, entry data stays untouched until requested
+	PackHeader header;
+	if (size < sizeof(PackHeader)) {
+		close();
+		return false;
+	}
+	memcpy(&header, base, sizeof(header));
+	if (header.magic != packMagic || header.version != packVersion ||
+		sizeof(PackHeader) + (uint64_t)header.entryCount * sizeof(PackEntry) > size) {
+		close();
+		return false;
+	}
+
+	const unsigned char *table = base + sizeof(PackHeader);
+	for (uint32_t i = 0; i < header.entryCount; ++i) {
+		PackEntry entry;
+		memcpy(&entry, table + i * sizeof(PackEntry), sizeof(entry));
+		if (entry.offset > size || entry.size > size - entry.offset || (uint64_t)entry.nameOffset + entry.nameLength > size) {
+			close();
+			return false;
+		}
+
+		std::string name((const char *)base + entry.nameOffset, entry.nameLength);
+		entries[name] = Entry{ entry.offset, entry.size };
+	}
+
+#ifndef _WIN32
+	// Assets are read front to back at startup
+	madvise((void *)base, size, MADV_WILLNEED);
+#endif
+	return true;
+}
+
+void AssetPack::close()
+{
+	entries.clear();
+#ifdef _WIN32
+	if (base)
+		UnmapViewOfFile(base);
+	if (mappingHandle)
+		CloseHandle((HANDLE)mappingHandle);
+	if (fileHandle)
+		CloseHandle((HANDLE)fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (base)
+		munmap((void *)base, size);
+#endif
+	base = nullptr;
+	size = 0;
+}
+
+bool AssetPack::find(const std::string &name, const unsigned char **data, size_t *entrySize) const
+{
+	if (!base)
+		return false;
+
+	auto found = entries.find(name);
+	if (found == entries.end())
+		return false;
+
+	*data = base + found->second.offset;
+	*entrySize = (size_t)found->second.size;
+	return true;
+}
+
+AssetPack &DefaultAssetPack()
+{
+	static AssetPack pack;
+	return pack;
+}
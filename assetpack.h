@@ -0,0 +1,73 @@
+#ifndef _ASSETPACK_H_
+#define _ASSETPACK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Read-only archive of many asset files, memory mapped as a whole.
+// Entries are looked up by the same relative path the scenes already use,
+// e.g. "../FinalProject/facade3.jpg", and handed out as pointers into the
+// mapping so decoders and glShaderSource read them without a copy.
+//
+// Layout (little endian):
+//   PackHeader
+//   PackEntry[entryCount]
+//   entry names, back to back (not NUL terminated)
+//   entry data, each entry aligned to packAlignment bytes
+class AssetPack {
+public:
+	AssetPack() {}
+	~AssetPack();
+
+	AssetPack(const AssetPack&) = delete;
+	AssetPack& operator=(const AssetPack&) = delete;
+
+	bool open(const char *pack_file_path);
+	void close();
+	bool isOpen() const { return base != nullptr; }
+
+	// Returns false when the pack is closed or has no such entry
+	bool find(const std::string &name, const unsigned char **data, size_t *size) const;
+
+	size_t entryCount() const { return entries.size(); }
+	size_t mappedSize() const { return size; }
+
+private:
+	struct Entry {
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	const unsigned char *base = nullptr;
+	size_t size = 0;
+	std::unordered_map<std::string, Entry> entries;
+#ifdef _WIN32
+	void *fileHandle = nullptr;
+	void *mappingHandle = nullptr;
+#endif
+};
+
+static const uint32_t packMagic = 0x4b434150;	// "PACK"
+static const uint32_t packVersion = 1;
+static const uint64_t packAlignment = 16;		// Keeps DDS blocks and shader text naturally aligned
+
+struct PackHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+};
+
+struct PackEntry {
+	uint64_t offset;		// From the start of the file
+	uint64_t size;
+	uint32_t nameOffset;	// From the start of the file
+	uint32_t nameLength;
+};
+
+// Pack mounted by the scene at startup; loaders consult it before touching the filesystem
+AssetPack &DefaultAssetPack();
+
+#endif
@@ -0,0 +1,110 @@
+// Chunk streaming benchmark: flies a camera along a straight line and times the
+// per-frame work of deciding which chunks to build and free.
+//
+//   bench_chunks streamer|scan|ring [frames] [radius] [--out FILE]
+//
+// streamer uses ChunkStreamer as the scenes that keep their tiles do. scan is the search
+// the demos used to make every frame: each cell in range looked up in the list of built
+// tiles. ring uses ChunkRing as terrainperlinnoise does, recycling the slots of tiles
+// that fall out of range.
+// frames defaults to 5000 and radius to 5 chunks, the scenes' renderDistance.
+
+#include "chunkstreamer.h"
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+	std::string mode = argc > 1 ? argv[1] : "";
+	if (mode != "streamer" && mode != "scan" && mode != "ring") {
+		std::cerr << "Usage: bench_chunks streamer|scan|ring [frames] [radius] [--out FILE]" << std::endl;
+		return 1;
+	}
+
+	int frames = 5000;
+	int radius = 5;
+	std::string outFile;
+	int positional = 0;
+	for (int i = 2; i < argc; ++i) {
+		if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			outFile = argv[++i];
+		} else if (positional == 0 && atoi(argv[i]) > 0) {
+			frames = atoi(argv[i]);
+			positional++;
+		} else if (positional == 1 && atoi(argv[i]) >= 0) {
+			radius = atoi(argv[i]);
+			positional++;
+		} else {
+			std::cerr << "Usage: bench_chunks streamer|scan|ring [frames] [radius] [--out FILE]" << std::endl;
+			return 1;
+		}
+	}
+
+	const float cellSize = 10.0f;
+	const float speed = 0.5f;				// World units per frame, a fast flight over the scene
+	ChunkStreamer streamer(cellSize, radius, false);
+	std::vector<ChunkCoord> entered, left;
+	std::vector<glm::vec3> built;			// Tile positions, as the scenes keep them
+	ChunkRing<glm::vec3> ring(cellSize, radius);
+	size_t recycled = 0;
+	std::vector<double> frameMs;
+	frameMs.reserve(frames);
+
+	auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frames; ++frame) {
+		glm::vec3 position(frame * speed, 50.0f, frame * speed * 0.5f);
+
+		auto frameStart = std::chrono::steady_clock::now();
+		if (mode == "ring") {
+			recycled += ring.update(position, [&](int x, int z, glm::vec3 &tile) {
+				tile = glm::vec3(x * cellSize, 0.0f, z * cellSize);
+			});
+		} else if (mode == "streamer") {
+			if (streamer.update(position, entered, left)) {
+				for (const ChunkCoord &cell : entered)
+					built.push_back(glm::vec3(std::get<0>(cell) * cellSize, 0.0f, std::get<1>(cell) * cellSize));
+			}
+		} else {
+			int centerX = (int)std::floor(position.x / cellSize);
+			int centerZ = (int)std::floor(position.z / cellSize);
+			for (int x = centerX - radius; x <= centerX + radius; ++x) {
+				for (int z = centerZ - radius; z <= centerZ + radius; ++z) {
+					glm::vec3 tilePosition(x * cellSize, 0.0f, z * cellSize);
+					if (std::none_of(built.begin(), built.end(), [&](const glm::vec3 &t) {
+						return t.x == tilePosition.x && t.z == tilePosition.z;
+					}))
+						built.push_back(tilePosition);
+				}
+			}
+		}
+		frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	SampleSummary summary = SummarizeSamples(frameMs);
+	size_t tilesBuilt = mode == "ring" ? recycled : built.size();
+	std::cout << "mode: " << mode << ", frames: " << frames << ", radius: " << radius << std::endl;
+	std::cout << "tiles built: " << tilesBuilt << std::endl;
+	std::cout << "time: " << seconds * 1000.0 << " ms" << std::endl;
+	std::cout << "frame ms: mean " << summary.mean << ", p99 " << summary.p99 << ", max " << summary.max << std::endl;
+
+	if (!outFile.empty()) {
+		BenchmarkReport report;
+		report.add("mode", mode);
+		report.add("frames", (double)frames);
+		report.add("radius", (double)radius);
+		report.add("tiles_built", (double)tilesBuilt);
+		report.add("frame_ms", summary);
+		if (!report.write(outFile.c_str()))
+			return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,110 @@
+// Terrain mesher benchmark: builds tiles the way terrainperlinnoise does (heightmap, error
+// hierarchy, adaptive mesh) on the worker pool and reports throughput and triangles saved.
+//
+//   bench_mesher [tiles] [error] [--threads N] [--out FILE]
+//
+// tiles defaults to 1024 and error, the world-space error allowed, to 0.1. The tiles are
+// 64 x 64 cells of 150 world units, over the same two octaves of noise as the scene.
+// --threads 0 (the default) sizes the pool like the scene, one thread per core but one.
+
+#include "terrainmesher.h"
+#include "threadpool.h"
+#include "noise.h"
+#include "benchmark.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const int tileGridSize = 64;
+static const float tileWorldSize = 150.0f;
+static const float heightScale = 18.0f;
+
+static float terrainHeight(float x, float z)
+{
+	float scale = 1.0f / 100.0f;
+	float noise = GradientNoise2D(x * scale, z * scale) + 0.25f * GradientNoise2D(x * scale * 4.0f, z * scale * 4.0f, 54321);
+	return (noise * 0.8f + 1.0f) * 0.5f * heightScale;
+}
+
+int main(int argc, char **argv)
+{
+	int tiles = 1024;
+	float maxError = 0.1f;
+	int threads = 0;
+	std::string outFile;
+
+	int positional = 0;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			outFile = argv[++i];
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (positional == 0 && atoi(argv[i]) > 0) {
+			tiles = atoi(argv[i]);
+			positional++;
+		} else if (positional == 1 && atof(argv[i]) >= 0.0) {
+			maxError = (float)atof(argv[i]);
+			positional++;
+		} else {
+			std::cerr << "Usage: bench_mesher [tiles] [error] [--threads N] [--out FILE]" << std::endl;
+			return 1;
+		}
+	}
+
+	TerrainMesher mesher(tileGridSize);
+	ThreadPool workers(threads < 0 ? 0 : threads);
+	std::atomic<long> triangles(0);
+	std::vector<double> tileMs(tiles);
+
+	// Tiles are laid out in rows of 32, as a flight over the terrain would request them
+	auto start = std::chrono::steady_clock::now();
+	for (int tile = 0; tile < tiles; ++tile) {
+		workers.submit([&, tile]() {
+			auto tileStart = std::chrono::steady_clock::now();
+			float offsetX = (tile % 32) * tileWorldSize;
+			float offsetZ = (tile / 32) * tileWorldSize;
+			float spacing = tileWorldSize / tileGridSize;
+
+			int side = tileGridSize + 1;
+			std::vector<float> heights(side * side);
+			for (int z = 0; z < side; ++z)
+				for (int x = 0; x < side; ++x)
+					heights[z * side + x] = terrainHeight(offsetX + x * spacing, offsetZ + z * spacing);
+
+			std::vector<float> errors;
+			std::vector<unsigned int> indices;
+			mesher.computeErrors(heights.data(), errors);
+			triangles += mesher.triangulate(errors, maxError, indices);
+			tileMs[tile] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tileStart).count();
+		});
+	}
+	workers.waitIdle();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	long fullTriangles = (long)tiles * mesher.fullTriangleCount();
+	double saved = 100.0 * (fullTriangles - triangles) / fullTriangles;
+	SampleSummary summary = SummarizeSamples(tileMs);
+	std::cout << "tiles: " << tiles << ", error: " << maxError << ", threads: " << workers.size() << std::endl;
+	std::cout << "triangles: " << triangles << " of " << fullTriangles << " (" << saved << "% saved)" << std::endl;
+	std::cout << "throughput: " << tiles / seconds << " tiles/s" << std::endl;
+	std::cout << "tile ms: mean " << summary.mean << ", p99 " << summary.p99 << ", max " << summary.max << std::endl;
+
+	if (!outFile.empty()) {
+		BenchmarkReport report;
+		report.add("tiles", (double)tiles);
+		report.add("error", (double)maxError);
+		report.add("threads", (double)workers.size());
+		report.add("triangles", (double)triangles);
+		report.add("triangles_saved_percent", saved);
+		report.add("tiles_per_second", tiles / seconds);
+		report.add("tile_ms", summary);
+		if (!report.write(outFile.c_str()))
+			return 1;
+	}
+	return 0;
+}
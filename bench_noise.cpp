@@ -0,0 +1,93 @@
+// Terrain noise benchmark: fills chunk heightmaps with GradientNoise2D the way
+// terrainperlinnoise builds its tiles, and reports the cost per sample.
+//
+//   bench_noise [chunks] [resolution] [--out FILE]
+//
+// chunks defaults to 4096 and resolution, the grid cells per chunk edge, to 16.
+// Compare builds with different optimisation profiles (see CMakeLists.txt) on the
+// same machine: the checksum must match between them.
+
+#include "noise.h"
+#include "benchmark.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+	int chunks = 4096;
+	int resolution = 16;
+	std::string outFile;
+
+	int positional = 0;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			outFile = argv[++i];
+		} else if (positional == 0 && atoi(argv[i]) > 0) {
+			chunks = atoi(argv[i]);
+			positional++;
+		} else if (positional == 1 && atoi(argv[i]) > 0) {
+			resolution = atoi(argv[i]);
+			positional++;
+		} else {
+			std::cerr << "Usage: bench_noise [chunks] [resolution] [--out FILE]" << std::endl;
+			return 1;
+		}
+	}
+
+	const float chunkWorldSize = 150.0f;
+	const float heightScale = 18.0f;
+	int side = resolution + 1;
+	std::vector<float> heightMap(side * side);
+	std::vector<double> chunkMs;
+	chunkMs.reserve(chunks);
+
+	// Walk chunks outward in rows, as a camera flying over the terrain would request them
+	int row = 1;
+	while (row * row < chunks)
+		row++;
+
+	double checksum = 0.0;
+	auto start = std::chrono::steady_clock::now();
+	for (int chunk = 0; chunk < chunks; ++chunk) {
+		float offsetX = (chunk % row - row / 2) * chunkWorldSize;
+		float offsetZ = (chunk / row - row / 2) * chunkWorldSize;
+		float step = chunkWorldSize / resolution;
+
+		auto chunkStart = std::chrono::steady_clock::now();
+		for (int z = 0; z < side; ++z) {
+			for (int x = 0; x < side; ++x) {
+				float noiseValue = GradientNoise2D(offsetX + x * step, offsetZ + z * step);
+				heightMap[z * side + x] = (noiseValue + 1.0f) * 0.5f * heightScale;
+			}
+		}
+		chunkMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - chunkStart).count());
+
+		for (float height : heightMap)
+			checksum += height;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	double samples = (double)chunks * side * side;
+	SampleSummary summary = SummarizeSamples(chunkMs);
+	std::cout << "chunks: " << chunks << ", samples per chunk: " << side * side << std::endl;
+	std::cout << "time: " << seconds * 1000.0 << " ms, " << seconds * 1e9 / samples << " ns per sample" << std::endl;
+	std::cout << "chunk ms: mean " << summary.mean << ", p95 " << summary.p95 << ", max " << summary.max << std::endl;
+	std::cout << "checksum: " << checksum << std::endl;
+
+	if (!outFile.empty()) {
+		BenchmarkReport report;
+		report.add("chunks", (double)chunks);
+		report.add("resolution", (double)resolution);
+		report.add("ns_per_sample", seconds * 1e9 / samples);
+		report.add("chunk_ms", summary);
+		report.add("checksum", checksum);
+		if (!report.write(outFile.c_str()))
+			return 1;
+	}
+	return 0;
+}
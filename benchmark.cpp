@@ -0,0 +1,245 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+static void PrintUsage(const char *program)
+{
+	std::cerr << "Usage: " << program << " [--benchmark] [--frames N] [--timestep S] [--path FILE]"
+		<< " [--seed N] [--context egl|osmesa] [--out FILE] [--record FILE] [--replay FILE] [--sim-thread]"
+		<< " [--occlusion cpu|gpu|off] [--view-distance D] [--impostor-distance D]"
+		<< " [--textures preload|async|sync] [--sky last|first]" << std::endl;
+}
+
+bool BenchmarkOptions::parse(int argc, char **argv)
+{
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--benchmark") {
+			enabled = true;
+		} else if (arg == "--frames" && hasValue) {
+			frames = std::max(1, atoi(argv[++i]));
+		} else if (arg == "--timestep" && hasValue) {
+			timestep = atof(argv[++i]);
+			if (!(timestep > 0.0)) {
+				std::cerr << "Timestep must be positive, got " << argv[i] << std::endl;
+				PrintUsage(argv[0]);
+				return false;
+			}
+		} else if (arg == "--path" && hasValue) {
+			pathFile = argv[++i];
+		} else if (arg == "--seed" && hasValue) {
+			seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		} else if (arg == "--context" && hasValue) {
+			std::string api = argv[++i];
+			if (api != "egl" && api != "osmesa") {
+				std::cerr << "Unknown context API " << api << std::endl;
+				PrintUsage(argv[0]);
+				return false;
+			}
+			useOSMesa = api == "osmesa";
+		} else if (arg == "--out" && hasValue) {
+			outFile = argv[++i];
+		} else if (arg == "--record" && hasValue) {
+			recordFile = argv[++i];
+		} else if (arg == "--replay" && hasValue) {
+			replayFile = argv[++i];
+		} else if (arg == "--sim-thread") {
+			simulationThread = true;
+		} else if (arg == "--occlusion" && hasValue) {
+			occlusion = argv[++i];
+			if (occlusion != "cpu" && occlusion != "gpu" && occlusion != "off") {
+				std::cerr << "Unknown occlusion mode " << occlusion << std::endl;
+				PrintUsage(argv[0]);
+				return false;
+			}
+		} else if (arg == "--view-distance" && hasValue) {
+			viewDistance = std::max(10.0f, (float)atof(argv[++i]));
+		} else if (arg == "--impostor-distance" && hasValue) {
+			impostorDistance = std::max(0.0f, (float)atof(argv[++i]));
+		} else if (arg == "--textures" && hasValue) {
+			textures = argv[++i];
+			if (textures != "preload" && textures != "async" && textures != "sync") {
+				std::cerr << "Unknown texture loading mode " << textures << std::endl;
+				PrintUsage(argv[0]);
+				return false;
+			}
+		} else if (arg == "--sky" && hasValue) {
+			sky = argv[++i];
+			if (sky != "last" && sky != "first") {
+				std::cerr << "Unknown sky order " << sky << std::endl;
+				PrintUsage(argv[0]);
+				return false;
+			}
+		} else {
+			PrintUsage(argv[0]);
+			return false;
+		}
+	}
+
+	if (!recordFile.empty() && !replayFile.empty()) {
+		std::cerr << "--record and --replay cannot be combined" << std::endl;
+		return false;
+	}
+	if (frames == 0 && replayFile.empty())
+		frames = 1800;
+	return true;
+}
+
+bool CameraPath::load(const char *path_file_path)
+{
+	std::ifstream file(path_file_path);
+	if (!file.is_open()) {
+		std::cerr << "Failed to open camera path " << path_file_path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream fields(line);
+		Keyframe key;
+		if (fields >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch)
+			keyframes.push_back(key);
+	}
+
+	std::sort(keyframes.begin(), keyframes.end(), [](const Keyframe &a, const Keyframe &b) { return a.time < b.time; });
+	source = path_file_path;
+	return !keyframes.empty();
+}
+
+void CameraPath::sample(double time, glm::vec3 &position, float &yaw, float &pitch) const
+{
+	if (keyframes.empty()) {
+		// Built-in flight: cruise down the -z axis at 10 units per second, weaving across
+		// the streets and panning left and right so new chunks enter the view at the sides
+		float t = float(time);
+		position = glm::vec3(5.0f + 12.0f * std::sin(t * 0.3f), 5.0f, 5.0f - 10.0f * t);
+		yaw = -90.0f + 35.0f * std::sin(t * 0.5f);
+		pitch = -5.0f + 4.0f * std::sin(t * 0.7f);
+		return;
+	}
+
+	if (time <= keyframes.front().time) {
+		position = keyframes.front().position;
+		yaw = keyframes.front().yaw;
+		pitch = keyframes.front().pitch;
+		return;
+	}
+	if (time >= keyframes.back().time) {
+		position = keyframes.back().position;
+		yaw = keyframes.back().yaw;
+		pitch = keyframes.back().pitch;
+		return;
+	}
+
+	// Linear interpolation between the two keyframes around time
+	size_t next = 1;
+	while (keyframes[next].time < time)
+		next++;
+	const Keyframe &a = keyframes[next - 1];
+	const Keyframe &b = keyframes[next];
+	float f = b.time > a.time ? float((time - a.time) / (b.time - a.time)) : 1.0f;
+	position = glm::mix(a.position, b.position, f);
+	yaw = a.yaw + (b.yaw - a.yaw) * f;
+	pitch = a.pitch + (b.pitch - a.pitch) * f;
+}
+
+std::string CameraPath::description() const
+{
+	return keyframes.empty() ? std::string("built-in flight") : source;
+}
+
+SampleSummary SummarizeSamples(std::vector<double> samples)
+{
+	SampleSummary summary;
+	if (samples.empty())
+		return summary;
+
+	std::sort(samples.begin(), samples.end());
+	double total = 0.0;
+	for (double sample : samples)
+		total += sample;
+
+	size_t count = samples.size();
+	summary.mean = total / count;
+	summary.p50 = samples[std::min(count - 1, count * 50 / 100)];
+	summary.p95 = samples[std::min(count - 1, count * 95 / 100)];
+	summary.p99 = samples[std::min(count - 1, count * 99 / 100)];
+	summary.max = samples.back();
+	return summary;
+}
+
+long PeakResidentKB()
+{
+#ifndef _WIN32
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		return usage.ru_maxrss;
+#endif
+	return 0;
+}
+
+static std::string FormatNumber(double value)
+{
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%.4f", value);
+	return buffer;
+}
+
+void BenchmarkReport::add(const char *name, double value)
+{
+	fields.push_back(std::make_pair(std::string(name), FormatNumber(value)));
+}
+
+void BenchmarkReport::add(const char *name, const std::string &value)
+{
+	std::string quoted = "\"";
+	for (char c : value) {
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		if ((unsigned char)c >= 0x20)
+			quoted += c;
+	}
+	quoted += "\"";
+	fields.push_back(std::make_pair(std::string(name), quoted));
+}
+
+void BenchmarkReport::add(const char *name, const SampleSummary &summary)
+{
+	std::string object = "{\"mean\": " + FormatNumber(summary.mean) + ", \"p50\": " + FormatNumber(summary.p50)
+		+ ", \"p95\": " + FormatNumber(summary.p95) + ", \"p99\": " + FormatNumber(summary.p99)
+		+ ", \"max\": " + FormatNumber(summary.max) + "}";
+	fields.push_back(std::make_pair(std::string(name), object));
+}
+
+bool BenchmarkReport::write(const char *path) const
+{
+	FILE *file = fopen(path, "w");
+	if (!file) {
+		std::cerr << "Failed to write benchmark report " << path << std::endl;
+		return false;
+	}
+
+	fprintf(file, "{\n");
+	for (size_t i = 0; i < fields.size(); ++i)
+		fprintf(file, "  \"%s\": %s%s\n", fields[i].first.c_str(), fields[i].second.c_str(), i + 1 < fields.size() ? "," : "");
+	fprintf(file, "}\n");
+	fclose(file);
+
+	std::cout << "Benchmark report written: " << path << std::endl;
+	return true;
+}
@@ -0,0 +1,101 @@
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Settings of the headless benchmark mode and input capture, parsed from the command line:
+//   --benchmark              run the scripted flight instead of the interactive scene
+//   --frames N               number of frames to render (default 1800, or the whole replay)
+//   --timestep S             simulated seconds per frame (default 1/60)
+//   --path FILE              camera keyframes, one "time x y z yaw pitch" per line
+//   --seed N                 city seed (default 12345)
+//   --context egl|osmesa     offscreen context creation API (default egl)
+//   --out FILE               JSON report (default benchmark.json)
+//   --record FILE            save the session's key and cursor input (see inputlog.h)
+//   --replay FILE            drive the camera from a recorded session instead of the path or live input
+//   --sim-thread             run simulation ticks on their own thread (interactive runs only)
+//   --occlusion cpu|gpu|off  hide what is behind the nearest buildings before drawing (default cpu),
+//                            or skip hidden building blocks with occlusion queries
+//   --view-distance D        far plane, buildings are generated this far out too (default 100)
+//   --impostor-distance D    draw buildings beyond D as impostor billboards, 0 for never (default 50)
+//   --textures preload|async|sync
+//                            load every texture before the first frame (default), or leave them to the
+//                            measured frames: streamed within the per-frame upload budget, or all
+//                            waited for in the first frame as blocking loads would
+//   --sky last|first         draw the sky after the scene where nothing covers it (default), or before
+//                            it over every pixel, for comparing the sky's cost
+struct BenchmarkOptions {
+	bool enabled = false;
+	int frames = 0;					// 0 picks the default
+	double timestep = 1.0 / 60.0;
+	std::string pathFile;
+	unsigned int seed = 12345;
+	bool useOSMesa = false;
+	std::string outFile = "benchmark.json";
+	std::string recordFile;
+	std::string replayFile;
+	bool simulationThread = false;
+	std::string occlusion = "cpu";
+	float viewDistance = 100.0f;
+	float impostorDistance = 50.0f;
+	std::string textures = "preload";
+	std::string sky = "last";
+
+	// Returns false and prints usage on a malformed argument
+	bool parse(int argc, char **argv);
+};
+
+// Camera pose as a function of simulated time. Either interpolates keyframes
+// loaded from a file, or follows a built-in flight over the city.
+class CameraPath {
+public:
+	bool load(const char *path_file_path);
+
+	void sample(double time, glm::vec3 &position, float &yaw, float &pitch) const;
+
+	std::string description() const;
+
+private:
+	struct Keyframe {
+		double time;
+		glm::vec3 position;
+		float yaw;
+		float pitch;
+	};
+
+	std::vector<Keyframe> keyframes;
+	std::string source;
+};
+
+// Summary of a series of per-frame samples, in milliseconds
+struct SampleSummary {
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+SampleSummary SummarizeSamples(std::vector<double> samples);
+
+// Peak resident set size of the process in kilobytes, 0 where unsupported
+long PeakResidentKB();
+
+// Minimal writer for the flat benchmark report: named numbers, strings and summaries
+class BenchmarkReport {
+public:
+	void add(const char *name, double value);
+	void add(const char *name, const std::string &value);
+	void add(const char *name, const SampleSummary &summary);
+
+	bool write(const char *path) const;
+
+private:
+	std::vector<std::pair<std::string, std::string>> fields;	// Name and JSON encoded value
+};
+
+#endif
@@ -6,21 +6,24 @@ layout(location = 1) in vec3 vertexColor;
 layout(location = 2) in vec2 vertexUV;
 layout(location = 3) in vec3 vertexNormal;
 
+// Per-instance input, one record per box
+layout(location = 4) in vec3 instancePosition;
+layout(location = 5) in vec3 instanceScale;
+
 out vec2 uv; 
 out vec3 color;
 out vec3 Normal; 
 out vec3 FragPos; 
 
 // Matrix for vertex transformation
-uniform mat4 model; 
-uniform mat4 MVP;
+uniform mat4 VP;
 
 
 void main() {
     	
-	// Transform the vertex position
-    gl_Position = MVP * vec4(vertexPosition, 1);
-    FragPos = vec3(model * vec4(vertexPosition, 1.0));
+	// Transform the vertex position, boxes are axis aligned so only scaled and moved
+    FragPos = instancePosition + vertexPosition * instanceScale;
+    gl_Position = VP * vec4(FragPos, 1.0);
 
     // Pass UV coordinates and color to the fragment shader
     uv = vertexUV; 
@@ -0,0 +1,234 @@
+#include "boxrenderer.h"
+#include "shader.h"
+#include "textureloader.h"
+
+#include <cstddef>
+#include <iostream>
+#include <utility>
+
+// Faces in the order front, back, left, right, top, bottom
+const GLfloat BoxRenderer::positions[72] = {
+	-1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f,
+	1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f,
+	-1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, -1.0f,
+	1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
+	-1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f,
+	-1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f,
+};
+
+const GLfloat BoxRenderer::normals[72] = {
+	0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+	0.0f, 0.0f, -1.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, -1.0f,
+	-1.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+	1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+	0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+	0.0f, -1.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, -1.0f, 0.0f,
+};
+
+const GLuint BoxRenderer::indices[36] = {
+	0, 1, 2, 0, 2, 3,
+	4, 5, 6, 4, 6, 7,
+	8, 9, 10, 8, 10, 11,
+	12, 13, 14, 12, 14, 15,
+	16, 17, 18, 16, 18, 19,
+	20, 21, 22, 20, 22, 23,
+};
+
+// One side face before the vertical repeat; the top and bottom map to a single texel
+static const GLfloat sideUVs[8] = {
+	0.0f, 1.0f,
+	1.0f, 1.0f,
+	1.0f, 0.0f,
+	0.0f, 0.0f,
+};
+
+void BoxRenderer::initialize(const char *vertex_file_path, const char *fragment_file_path, const std::vector<std::string> &textureFiles, float uvRepeat)
+{
+	for (int face = 0; face < 6; ++face) {
+		for (int i = 0; i < 8; i += 2) {
+			bool side = face < 4;
+			uvs[face * 8 + i] = side ? sideUVs[i] : 0.0f;
+			uvs[face * 8 + i + 1] = side ? sideUVs[i + 1] * uvRepeat : 0.0f;
+		}
+	}
+
+	// Every box is white, the colour attribute is there for programs that tint by it
+	GLfloat colors[72];
+	for (int i = 0; i < 72; ++i)
+		colors[i] = 1.0f;
+
+	positionBuffer = GLBuffer::create();
+	glBindBuffer(GL_ARRAY_BUFFER, positionBuffer.get());
+	glBufferData(GL_ARRAY_BUFFER, sizeof(positions), positions, GL_STATIC_DRAW);
+
+	colorBuffer = GLBuffer::create();
+	glBindBuffer(GL_ARRAY_BUFFER, colorBuffer.get());
+	glBufferData(GL_ARRAY_BUFFER, sizeof(colors), colors, GL_STATIC_DRAW);
+
+	uvBufferObject = GLBuffer::create();
+	glBindBuffer(GL_ARRAY_BUFFER, uvBufferObject.get());
+	glBufferData(GL_ARRAY_BUFFER, sizeof(uvs), uvs, GL_STATIC_DRAW);
+
+	normalBufferObject = GLBuffer::create();
+	glBindBuffer(GL_ARRAY_BUFFER, normalBufferObject.get());
+	glBufferData(GL_ARRAY_BUFFER, sizeof(normals), normals, GL_STATIC_DRAW);
+
+	indexBufferObject = GLBuffer::create();
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject.get());
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+	program = GLProgram(LoadShadersFromFile(vertex_file_path, fragment_file_path));
+	if (!program)
+		std::cerr << "Failed to load box shaders." << std::endl;
+
+	viewProjectionID = glGetUniformLocation(program.get(), "VP");
+	glUseProgram(program.get());
+	glUniform1i(glGetUniformLocation(program.get(), "textureSampler"), 0);
+	glUseProgram(0);
+
+	// Each texture is loaded once and shared by all its boxes
+	batches.resize(textureFiles.size());
+	for (size_t i = 0; i < textureFiles.size(); ++i) {
+		BoxBatch &batch = batches[i];
+		batch.vao = GLVertexArray::create();
+		batch.instanceBuffer = GLBuffer::create();
+		batch.texture = LoadTexture(textureFiles[i].c_str());
+		setupBatchVAO(batch);
+	}
+}
+
+void BoxRenderer::cleanup()
+{
+	batches.clear();
+	positionBuffer.reset();
+	colorBuffer.reset();
+	uvBufferObject.reset();
+	normalBufferObject.reset();
+	indexBufferObject.reset();
+	program.reset();
+}
+
+// Record the shared geometry and the batch's instance buffer in the batch's VAO
+void BoxRenderer::setupBatchVAO(BoxBatch &batch)
+{
+	glBindVertexArray(batch.vao.get());
+
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, positionBuffer.get());
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+	glEnableVertexAttribArray(1);
+	glBindBuffer(GL_ARRAY_BUFFER, colorBuffer.get());
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+	glEnableVertexAttribArray(2);
+	glBindBuffer(GL_ARRAY_BUFFER, uvBufferObject.get());
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+	glEnableVertexAttribArray(3);
+	glBindBuffer(GL_ARRAY_BUFFER, normalBufferObject.get());
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+	glEnableVertexAttribArray(4);
+	glBindBuffer(GL_ARRAY_BUFFER, batch.instanceBuffer.get());
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(BoxInstance), (void*)offsetof(BoxInstance, position));
+	glVertexAttribDivisor(4, 1);
+
+	glEnableVertexAttribArray(5);
+	glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(BoxInstance), (void*)offsetof(BoxInstance, scale));
+	glVertexAttribDivisor(5, 1);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject.get());
+
+	glBindVertexArray(0);
+}
+
+// Grow the batch's instance buffer geometrically, keeping the records already uploaded
+void BoxRenderer::reserveInstances(BoxBatch &batch, int required)
+{
+	if (required <= batch.instanceCapacity)
+		return;
+
+	int newCapacity = batch.instanceCapacity > 0 ? batch.instanceCapacity : 64;
+	while (newCapacity < required)
+		newCapacity *= 2;
+
+	GLBuffer newBuffer = GLBuffer::create();
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer.get());
+	glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * sizeof(BoxInstance), NULL, GL_DYNAMIC_DRAW);
+
+	if (batch.instanceCount > 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, batch.instanceBuffer.get());
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, batch.instanceCount * sizeof(BoxInstance));
+	}
+
+	// The old buffer is deleted once draws still in flight have finished with it
+	batch.instanceBuffer = std::move(newBuffer);
+	batch.instanceCapacity = newCapacity;
+	setupBatchVAO(batch);
+}
+
+int BoxRenderer::append(int batch, const BoxInstance *boxes, int count)
+{
+	BoxBatch &target = batches[batch];
+	int first = target.instanceCount;
+	if (count <= 0)
+		return first;
+
+	reserveInstances(target, first + count);
+	glBindBuffer(GL_ARRAY_BUFFER, target.instanceBuffer.get());
+	glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(BoxInstance), count * sizeof(BoxInstance), boxes);
+	target.instanceCount += count;
+	return first;
+}
+
+void BoxRenderer::beginRender(const glm::mat4 &viewProjection)
+{
+	glUseProgram(program.get());
+	glUniformMatrix4fv(viewProjectionID, 1, GL_FALSE, &viewProjection[0][0]);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void BoxRenderer::draw(int batch, GLuint buffer, GLintptr offset, int count)
+{
+	const BoxBatch &source = batches[batch];
+	glBindVertexArray(source.vao.get());
+	glBindTexture(GL_TEXTURE_2D, source.texture);
+
+	// Instance attributes are re-pointed, the records may sit anywhere in any buffer
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(BoxInstance), (void*)(offset + offsetof(BoxInstance, position)));
+	glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(BoxInstance), (void*)(offset + offsetof(BoxInstance, scale)));
+
+	glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (void*)0, count);
+}
+
+void BoxRenderer::render(const glm::mat4 &viewProjection)
+{
+	beginRender(viewProjection);
+
+	for (size_t i = 0; i < batches.size(); ++i) {
+		if (batches[i].instanceCount > 0)
+			draw((int)i, batches[i].instanceBuffer.get(), 0, batches[i].instanceCount);
+	}
+
+	glBindVertexArray(0);
+}
+
+void BoxRenderer::render(const std::vector<std::vector<BoxInstance>> &boxes, StreamBuffer &stream, const glm::mat4 &viewProjection)
+{
+	beginRender(viewProjection);
+
+	for (size_t i = 0; i < boxes.size() && i < batches.size(); ++i) {
+		const std::vector<BoxInstance> &records = boxes[i];
+		if (records.empty())
+			continue;
+
+		GLintptr offset = stream.write(records.data(), records.size() * sizeof(BoxInstance));
+		if (offset < 0)
+			continue;
+		draw((int)i, stream.buffer(), offset, (int)records.size());
+	}
+
+	glBindVertexArray(0);
+}
@@ -0,0 +1,82 @@
+#ifndef _BOXRENDERER_H_
+#define _BOXRENDERER_H_
+
+#include "glresource.h"
+#include "streambuffer.h"
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// An axis aligned box, centred on position and reaching scale from it along each axis
+struct BoxInstance {
+	glm::vec3 position;
+	glm::vec3 scale;
+};
+
+// Boxes sharing a texture, kept in one instance buffer and drawn with one instanced call
+struct BoxBatch {
+	GLVertexArray vao;			// Shared box geometry plus this batch's instance attributes
+	GLBuffer instanceBuffer;	// Packed BoxInstance records
+	GLuint texture = 0;			// Owned by the texture loader
+	int instanceCount = 0;
+	int instanceCapacity = 0;
+};
+
+// Draws textured boxes, such as buildings, one batch per texture. Every box is the canonical cube
+// from -1 to 1 with four vertices per face, so each face has its own normal and uvs. The side faces
+// repeat the texture uvRepeat times upwards, the top and bottom are untextured.
+// The scene's shaders read vertex attributes 0 position, 1 colour (white), 2 uv, 3 normal, and
+// 4 and 5 the box's position and scale. The texture is bound to unit 0 as textureSampler, and a
+// VP uniform, if the program has one, receives the view-projection matrix.
+class BoxRenderer {
+public:
+	static const GLfloat positions[72];
+	static const GLfloat normals[72];
+	static const GLuint indices[36];
+	GLfloat uvs[48];					// Set up by initialize()
+
+	std::vector<BoxBatch> batches;		// One per texture, in the order given
+
+	// Needs the GL context. The program is compiled once here, set its other uniforms through programID().
+	void initialize(const char *vertex_file_path, const char *fragment_file_path, const std::vector<std::string> &textureFiles, float uvRepeat = 1.0f);
+	void cleanup();
+
+	// Add boxes to the end of a batch's instance buffer, in one upload. Returns the index of the first.
+	int append(int batch, const BoxInstance *boxes, int count);
+
+	// Draw every box appended so far
+	void render(const glm::mat4 &viewProjection);
+
+	// Draw the given boxes instead, one list per batch, written to this frame's region of stream
+	void render(const std::vector<std::vector<BoxInstance>> &boxes, StreamBuffer &stream, const glm::mat4 &viewProjection);
+
+	// Make the program current for draw()
+	void beginRender(const glm::mat4 &viewProjection);
+
+	// Draw count records read from offset in buffer with the batch's texture and the current
+	// program, which may be any that reads the attributes above
+	void draw(int batch, GLuint buffer, GLintptr offset, int count);
+
+	GLuint programID() const { return program.get(); }
+	GLuint vertexBuffer() const { return positionBuffer.get(); }
+	GLuint uvBuffer() const { return uvBufferObject.get(); }
+	GLuint normalBuffer() const { return normalBufferObject.get(); }
+	GLuint indexBuffer() const { return indexBufferObject.get(); }
+
+private:
+	void setupBatchVAO(BoxBatch &batch);
+	void reserveInstances(BoxBatch &batch, int required);
+
+	GLProgram program;
+	GLint viewProjectionID = -1;
+
+	// Shared by every batch
+	GLBuffer positionBuffer;
+	GLBuffer colorBuffer;
+	GLBuffer uvBufferObject;
+	GLBuffer normalBufferObject;
+	GLBuffer indexBufferObject;
+};
+
+#endif
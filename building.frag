@@ -0,0 +1,36 @@
+#version 330 core
+
+in vec2 uv; 
+in vec3 color;
+in vec3 Normal;
+in vec3 FragPos;  
+flat in float fade;
+
+uniform sampler2D textureSampler;  
+uniform vec3 lightColor;      // Color of the light
+
+#include "shadow.glsl"
+#include "dither.glsl"
+
+out vec4 finalColor;
+
+void main()
+{
+    if (ditherThreshold() > fade)
+        discard;
+
+    float ambientStrength = 0.1;
+    vec3 ambient = ambientStrength * lightColor;
+
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = towardsLight.xyz;
+
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightColor * sunVisibility(FragPos, norm);
+
+    vec3 result = (ambient + diffuse) * color;
+
+    result *= texture(textureSampler, uv).rgb;
+    
+    finalColor = vec4(result, 1.0);
+}
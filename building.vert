@@ -0,0 +1,39 @@
+#version 330 core
+
+// Input
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec3 vertexColor;
+layout(location = 2) in vec2 vertexUV;
+layout(location = 3) in vec3 vertexNormal;
+
+// Per-instance input, one record per building
+layout(location = 4) in vec3 instancePosition;
+layout(location = 5) in vec3 instanceScale;
+
+out vec2 uv; 
+out vec3 color;
+out vec3 Normal; 
+out vec3 FragPos; 
+flat out float fade;
+
+// Per-frame uniforms shared with the tile program
+layout(std140) uniform FrameData {
+    mat4 VP;
+    vec4 eye;       // Camera position
+    vec4 lodRange;  // Distance over which buildings fade out as their impostors fade in
+};
+
+void main() {
+    // Buildings are axis aligned boxes, so the model transform is a scale followed by a translation
+    FragPos = instancePosition + vertexPosition * instanceScale;
+    gl_Position = VP * vec4(FragPos, 1.0);
+
+    // Pass UV coordinates and color to the fragment shader
+    uv = vertexUV; 
+    color = vertexColor; 
+    Normal = vertexNormal;
+
+    // Measured to the box centre, the same way impostor.vert does, so the two fades add up to one
+    float distance = length(instancePosition.xz - eye.xz);
+    fade = 1.0 - clamp((distance - lodRange.x) / (lodRange.y - lodRange.x), 0.0, 1.0);
+}
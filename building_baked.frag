@@ -0,0 +1,29 @@
+#version 330 core
+
+in vec3 uv;
+in vec3 Normal;
+in vec3 FragPos;
+
+uniform sampler2DArray facades;
+uniform vec3 lightColor;      // Color of the light
+
+#include "shadow.glsl"
+
+out vec4 finalColor;
+
+void main()
+{
+    // Same lighting as building.frag
+    float ambientStrength = 0.1;
+    vec3 ambient = ambientStrength * lightColor;
+
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = towardsLight.xyz;
+
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightColor * sunVisibility(FragPos, norm);
+
+    vec3 result = (ambient + diffuse) * texture(facades, uv).rgb;
+
+    finalColor = vec4(result, 1.0);
+}
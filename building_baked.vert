@@ -0,0 +1,25 @@
+#version 330 core
+
+// Input, already in world space
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec3 vertexNormal;
+layout(location = 2) in vec2 vertexUV;
+layout(location = 3) in float vertexLayer;  // Facade, a layer of the facade array
+
+out vec3 uv;
+out vec3 Normal;
+out vec3 FragPos;
+
+// Per-frame uniforms shared with the tile program
+layout(std140) uniform FrameData {
+    mat4 VP;
+};
+
+void main() {
+    // Chunk meshes are baked in place, there is no model transform
+    FragPos = vertexPosition;
+    gl_Position = VP * vec4(FragPos, 1.0);
+
+    uv = vec3(vertexUV, vertexLayer);
+    Normal = vertexNormal;
+}
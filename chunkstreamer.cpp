@@ -0,0 +1,48 @@
+#include "chunkstreamer.h"
+
+#include <cmath>
+#include <cstdlib>
+
+ChunkStreamer::ChunkStreamer(float chunkSize, int radius, bool unload)
+	: size(chunkSize), radius(radius), unload(unload)
+{
+}
+
+int ChunkStreamer::chunkOf(float coordinate) const
+{
+	return (int)std::floor(coordinate / size);
+}
+
+bool ChunkStreamer::update(const glm::vec3 &position, std::vector<ChunkCoord> &entered, std::vector<ChunkCoord> &left)
+{
+	entered.clear();
+	left.clear();
+
+	int x = chunkOf(position.x);
+	int z = chunkOf(position.z);
+	if (started && x == centerX && z == centerZ)
+		return false;
+	started = true;
+	centerX = x;
+	centerZ = z;
+
+	for (int dx = -radius; dx <= radius; ++dx) {
+		for (int dz = -radius; dz <= radius; ++dz) {
+			ChunkCoord chunk(x + dx, z + dz);
+			if (chunks.insert(chunk).second)
+				entered.push_back(chunk);
+		}
+	}
+
+	if (unload) {
+		for (auto it = chunks.begin(); it != chunks.end();) {
+			if (std::abs(std::get<0>(*it) - x) > radius || std::abs(std::get<1>(*it) - z) > radius) {
+				left.push_back(*it);
+				it = chunks.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+	return true;
+}
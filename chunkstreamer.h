@@ -0,0 +1,145 @@
+#ifndef _CHUNKSTREAMER_H_
+#define _CHUNKSTREAMER_H_
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+// Custom hash function for std::tuple<int, int>
+struct TupleHash {
+	template <typename T1, typename T2>
+	std::size_t operator()(const std::tuple<T1, T2>& t) const {
+		auto h1 = std::hash<T1>{}(std::get<0>(t));
+		auto h2 = std::hash<T2>{}(std::get<1>(t));
+		return h1 ^ (h2 << 1);
+	}
+};
+
+typedef std::tuple<int, int> ChunkCoord;
+
+// Tracks which chunks of a square grid on the xz plane lie within radius chunks of the viewer.
+// update() only reports the chunks that came into range and those that went out of it, so a
+// scene builds and frees what changed instead of searching everything it has built every frame.
+class ChunkStreamer {
+public:
+	// With unload off, chunks stay resident once entered and left is never filled
+	ChunkStreamer(float chunkSize, int radius, bool unload = true);
+
+	// Returns false, with both lists empty, while the viewer stays in the same chunk
+	bool update(const glm::vec3 &position, std::vector<ChunkCoord> &entered, std::vector<ChunkCoord> &left);
+
+	bool resident(int x, int z) const { return chunks.count(ChunkCoord(x, z)) != 0; }
+	const std::unordered_set<ChunkCoord, TupleHash> &residentChunks() const { return chunks; }
+
+	// Chunk containing a world position, chunks span [x * chunkSize, (x + 1) * chunkSize)
+	int chunkOf(float coordinate) const;
+
+	float chunkSize() const { return size; }
+
+private:
+	float size;
+	int radius;
+	bool unload;
+	bool started = false;
+	int centerX = 0;
+	int centerZ = 0;
+	std::unordered_set<ChunkCoord, TupleHash> chunks;
+};
+
+// Fixed (2 * radius + 1)^2 window of chunk slots around the viewer, for scenes that free what
+// goes out of range. Chunk (x, z) always lives in slot (x mod N, z mod N), so when the viewer
+// crosses a chunk boundary the slots of the row or column left behind are exactly the ones the
+// newly exposed row or column needs, and only those are recycled. No hashing or allocation
+// happens after construction; frames that stay in the same chunk do no work at all.
+template <typename Slot>
+class ChunkRing {
+public:
+	ChunkRing(float chunkSize, int radius)
+		: size(chunkSize), radius(radius), side(2 * radius + 1), slots(side * side)
+	{
+	}
+
+	// Calls recycle(x, z, slot) for every slot that now holds chunk (x, z) instead of whatever
+	// it held before, which the callback replaces. Slots start value-initialised. Returns the
+	// number of slots recycled.
+	template <typename Recycle>
+	int update(const glm::vec3 &position, Recycle &&recycle)
+	{
+		int x = chunkOf(position.x);
+		int z = chunkOf(position.z);
+		if (started && x == centerX && z == centerZ)
+			return 0;
+
+		int recycled = 0;
+		for (int cx = x - radius; cx <= x + radius; ++cx) {
+			bool oldColumn = started && std::abs(cx - centerX) <= radius;
+			for (int cz = z - radius; cz <= z + radius; ++cz) {
+				// Chunks still in range of the old centre are already in their slots
+				if (oldColumn && std::abs(cz - centerZ) <= radius)
+					continue;
+				Entry &entry = slots[index(cx, cz)];
+				entry.x = cx;
+				entry.z = cz;
+				entry.filled = true;
+				recycle(cx, cz, entry.slot);
+				recycled++;
+			}
+		}
+
+		started = true;
+		centerX = x;
+		centerZ = z;
+		return recycled;
+	}
+
+	// Calls visit(x, z, slot) for every filled slot
+	template <typename Visit>
+	void forEach(Visit &&visit)
+	{
+		for (Entry &entry : slots)
+			if (entry.filled)
+				visit(entry.x, entry.z, entry.slot);
+	}
+
+	// Slot for a chunk in range, NULL otherwise
+	Slot *find(int x, int z)
+	{
+		Entry &entry = slots[index(x, z)];
+		return entry.filled && entry.x == x && entry.z == z ? &entry.slot : NULL;
+	}
+
+	int chunkOf(float coordinate) const { return (int)std::floor(coordinate / size); }
+	float chunkSize() const { return size; }
+	int slotCount() const { return (int)slots.size(); }
+
+private:
+	struct Entry {
+		int x = 0;
+		int z = 0;
+		bool filled = false;
+		Slot slot = Slot();
+	};
+
+	int index(int x, int z) const
+	{
+		int column = ((x % side) + side) % side;
+		int row = ((z % side) + side) % side;
+		return row * side + column;
+	}
+
+	float size;
+	int radius;
+	int side;
+	bool started = false;
+	int centerX = 0;
+	int centerZ = 0;
+	std::vector<Entry> slots;
+};
+
+#endif
@@ -0,0 +1,414 @@
+#include "dds.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static const uint32_t DDS_MAGIC = 0x20534444;		// "DDS "
+static const uint32_t FOURCC_DXT1 = 0x31545844;		// "DXT1"
+static const uint32_t FOURCC_DXT5 = 0x35545844;		// "DXT5"
+
+static const uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+static const uint32_t DDPF_FOURCC = 0x4;
+static const uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+
+struct DDSPixelFormat {
+	uint32_t size;
+	uint32_t flags;
+	uint32_t fourCC;
+	uint32_t rgbBitCount;
+	uint32_t rBitMask, gBitMask, bBitMask, aBitMask;
+};
+
+struct DDSHeader {
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitchOrLinearSize;
+	uint32_t depth;
+	uint32_t mipMapCount;
+	uint32_t reserved1[11];
+	DDSPixelFormat pixelFormat;
+	uint32_t caps, caps2, caps3, caps4;
+	uint32_t reserved2;
+};
+
+static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+
+size_t DDSBlockBytes(DDSFormat format)
+{
+	return format == DDS_BC1 ? 8 : 16;
+}
+
+size_t DDSLevelSize(DDSFormat format, int width, int height)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * DDSBlockBytes(format);
+}
+
+bool ParseDDS(const unsigned char *bytes, size_t size, DDSImage &image)
+{
+	if (size < 4 + sizeof(DDSHeader))
+		return false;
+
+	uint32_t magic;
+	DDSHeader header;
+	memcpy(&magic, bytes, 4);
+	memcpy(&header, bytes + 4, sizeof(DDSHeader));
+	if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader) || !(header.pixelFormat.flags & DDPF_FOURCC))
+		return false;
+
+	if (header.pixelFormat.fourCC == FOURCC_DXT1)
+		image.format = DDS_BC1;
+	else if (header.pixelFormat.fourCC == FOURCC_DXT5)
+		image.format = DDS_BC3;
+	else
+		return false;
+
+	// Sizes must fit an int, and a chain cannot go past the 1x1 level
+	if (header.width == 0 || header.height == 0 || header.width > INT32_MAX || header.height > INT32_MAX)
+		return false;
+	uint32_t fullChain = 1;
+	for (uint32_t largest = std::max(header.width, header.height); largest > 1; largest >>= 1)
+		fullChain++;
+	uint32_t mipCount = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount > 0 ? header.mipMapCount : 1;
+	if (mipCount > fullChain)
+		return false;
+
+	image.width = (int)header.width;
+	image.height = (int)header.height;
+	image.mipCount = (int)mipCount;
+	image.data = bytes + 4 + sizeof(DDSHeader);
+	image.dataSize = size - 4 - sizeof(DDSHeader);
+
+	image.mipOffsets.clear();
+	image.mipSizes.clear();
+	size_t offset = 0;
+	int w = image.width, h = image.height;
+	for (int level = 0; level < image.mipCount; ++level) {
+		size_t levelSize = DDSLevelSize(image.format, w, h);
+		if (offset + levelSize > image.dataSize)
+			return false;
+		image.mipOffsets.push_back(offset);
+		image.mipSizes.push_back(levelSize);
+		offset += levelSize;
+		w = std::max(1, w / 2);
+		h = std::max(1, h / 2);
+	}
+	return true;
+}
+
+bool LoadDDS(const char *dds_file_path, DDSImage &image)
+{
+	std::ifstream file(dds_file_path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamsize size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	image.storage.resize((size_t)size);
+	if (!file.read((char *)image.storage.data(), size))
+		return false;
+
+	return ParseDDS(image.storage.data(), image.storage.size(), image);
+}
+
+std::string BakedTexturePath(const std::string &texture_file_path)
+{
+	size_t dot = texture_file_path.find_last_of('.');
+	size_t slash = texture_file_path.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return texture_file_path + ".dds";
+	return texture_file_path.substr(0, dot) + ".dds";
+}
+
+// ---------------------------------------------------------------------------
+// Block encoding
+
+static uint16_t PackRGB565(const unsigned char *c)
+{
+	return (uint16_t)(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3));
+}
+
+static void UnpackRGB565(uint16_t v, unsigned char *c)
+{
+	unsigned char r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+	c[0] = (unsigned char)((r << 3) | (r >> 2));
+	c[1] = (unsigned char)((g << 2) | (g >> 4));
+	c[2] = (unsigned char)((b << 3) | (b >> 2));
+	c[3] = 255;
+}
+
+// Four-colour palette from two 565 endpoints. Three-colour mode only when allowed (BC1, c0 <= c1).
+static void BuildPalette(uint16_t c0, uint16_t c1, bool allowThreeColour, unsigned char palette[4][4])
+{
+	UnpackRGB565(c0, palette[0]);
+	UnpackRGB565(c1, palette[1]);
+	if (c0 > c1 || !allowThreeColour) {
+		for (int i = 0; i < 3; ++i) {
+			palette[2][i] = (unsigned char)((2 * palette[0][i] + palette[1][i]) / 3);
+			palette[3][i] = (unsigned char)((palette[0][i] + 2 * palette[1][i]) / 3);
+		}
+		palette[2][3] = palette[3][3] = 255;
+	} else {
+		for (int i = 0; i < 3; ++i) {
+			palette[2][i] = (unsigned char)((palette[0][i] + palette[1][i]) / 2);
+			palette[3][i] = 0;
+		}
+		palette[2][3] = 255;
+		palette[3][3] = 0;
+	}
+}
+
+// Range fit: endpoints are the block's bounding box corners, each texel takes the nearest palette entry
+static void CompressColourBlock(const unsigned char rgba[64], unsigned char out[8])
+{
+	unsigned char lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; ++i) {
+		for (int c = 0; c < 3; ++c) {
+			lo[c] = std::min(lo[c], rgba[i * 4 + c]);
+			hi[c] = std::max(hi[c], rgba[i * 4 + c]);
+		}
+	}
+
+	uint16_t c0 = PackRGB565(hi);
+	uint16_t c1 = PackRGB565(lo);
+	uint32_t indices = 0;
+
+	if (c0 < c1)
+		std::swap(c0, c1);
+
+	if (c0 != c1) {
+		unsigned char palette[4][4];
+		BuildPalette(c0, c1, false, palette);
+		for (int i = 0; i < 16; ++i) {
+			int best = 0, bestDistance = 1 << 30;
+			for (int p = 0; p < 4; ++p) {
+				int dr = rgba[i * 4] - palette[p][0];
+				int dg = rgba[i * 4 + 1] - palette[p][1];
+				int db = rgba[i * 4 + 2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (uint32_t)best << (2 * i);
+		}
+	}
+
+	out[0] = c0 & 0xff;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 0xff;
+	out[3] = c1 >> 8;
+	memcpy(out + 4, &indices, 4);
+}
+
+static void CompressAlphaBlock(const unsigned char rgba[64], unsigned char out[8])
+{
+	unsigned char a0 = 0, a1 = 255;
+	for (int i = 0; i < 16; ++i) {
+		a0 = std::max(a0, rgba[i * 4 + 3]);
+		a1 = std::min(a1, rgba[i * 4 + 3]);
+	}
+
+	out[0] = a0;
+	out[1] = a1;
+	uint64_t indices = 0;
+	if (a0 != a1) {
+		// Eight interpolated values between a0 (index 0) and a1 (index 1)
+		unsigned char palette[8] = { a0, a1 };
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = (unsigned char)(((7 - i) * a0 + i * a1) / 7);
+
+		for (int i = 0; i < 16; ++i) {
+			int best = 0, bestDistance = 256;
+			for (int p = 0; p < 8; ++p) {
+				int distance = std::abs(rgba[i * 4 + 3] - palette[p]);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (uint64_t)best << (3 * i);
+		}
+	}
+	for (int i = 0; i < 6; ++i)
+		out[2 + i] = (unsigned char)(indices >> (8 * i));
+}
+
+static void DecompressColourBlock(const unsigned char in[8], bool allowThreeColour, unsigned char rgba[64])
+{
+	uint16_t c0 = (uint16_t)(in[0] | (in[1] << 8));
+	uint16_t c1 = (uint16_t)(in[2] | (in[3] << 8));
+	uint32_t indices;
+	memcpy(&indices, in + 4, 4);
+
+	unsigned char palette[4][4];
+	BuildPalette(c0, c1, allowThreeColour, palette);
+	for (int i = 0; i < 16; ++i)
+		memcpy(rgba + i * 4, palette[(indices >> (2 * i)) & 3], 4);
+}
+
+static void DecompressAlphaBlock(const unsigned char in[8], unsigned char rgba[64])
+{
+	unsigned char a0 = in[0], a1 = in[1];
+	unsigned char palette[8] = { a0, a1 };
+	if (a0 > a1) {
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = (unsigned char)(((7 - i) * a0 + i * a1) / 7);
+	} else {
+		for (int i = 1; i < 5; ++i)
+			palette[i + 1] = (unsigned char)(((5 - i) * a0 + i * a1) / 5);
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; ++i)
+		indices |= (uint64_t)in[2 + i] << (8 * i);
+	for (int i = 0; i < 16; ++i)
+		rgba[i * 4 + 3] = palette[(indices >> (3 * i)) & 7];
+}
+
+// Gather a 4x4 block, clamping at the right and bottom edges of odd sized images
+static void FetchBlock(const unsigned char *rgba, int width, int height, int bx, int by, unsigned char block[64])
+{
+	for (int y = 0; y < 4; ++y) {
+		for (int x = 0; x < 4; ++x) {
+			int sx = std::min(bx * 4 + x, width - 1);
+			int sy = std::min(by * 4 + y, height - 1);
+			memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+		}
+	}
+}
+
+void CompressImage(DDSFormat format, const unsigned char *rgba, int width, int height, unsigned char *blocks)
+{
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	size_t blockBytes = DDSBlockBytes(format);
+	unsigned char block[64];
+
+	for (int by = 0; by < blocksY; ++by) {
+		for (int bx = 0; bx < blocksX; ++bx) {
+			FetchBlock(rgba, width, height, bx, by, block);
+			unsigned char *out = blocks + ((size_t)by * blocksX + bx) * blockBytes;
+			if (format == DDS_BC3) {
+				CompressAlphaBlock(block, out);
+				CompressColourBlock(block, out + 8);
+			} else {
+				CompressColourBlock(block, out);
+			}
+		}
+	}
+}
+
+void DecompressImage(DDSFormat format, const unsigned char *blocks, int width, int height, unsigned char *rgba)
+{
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	size_t blockBytes = DDSBlockBytes(format);
+	unsigned char block[64];
+
+	for (int by = 0; by < blocksY; ++by) {
+		for (int bx = 0; bx < blocksX; ++bx) {
+			const unsigned char *in = blocks + ((size_t)by * blocksX + bx) * blockBytes;
+			if (format == DDS_BC3) {
+				DecompressColourBlock(in + 8, false, block);
+				DecompressAlphaBlock(in, block);
+			} else {
+				DecompressColourBlock(in, true, block);
+			}
+
+			for (int y = 0; y < 4 && by * 4 + y < height; ++y) {
+				for (int x = 0; x < 4 && bx * 4 + x < width; ++x) {
+					memcpy(rgba + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, block + (y * 4 + x) * 4, 4);
+				}
+			}
+		}
+	}
+}
+
+// 2x2 box filter, odd dimensions repeat the last row/column
+static void Downsample(const unsigned char *pixels, int width, int height, int channels, unsigned char *result)
+{
+	int w = std::max(1, width / 2), h = std::max(1, height / 2);
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+			int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+			for (int c = 0; c < channels; ++c) {
+				int sum = pixels[((size_t)y0 * width + x0) * channels + c] + pixels[((size_t)y0 * width + x1) * channels + c]
+					+ pixels[((size_t)y1 * width + x0) * channels + c] + pixels[((size_t)y1 * width + x1) * channels + c];
+				result[((size_t)y * w + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+void BuildMipChain(const unsigned char *pixels, int width, int height, int channels,
+	std::vector<unsigned char> &levels, std::vector<size_t> &offsets)
+{
+	size_t total = 0;
+	int w = width, h = height;
+	offsets.clear();
+	while (true) {
+		offsets.push_back(total);
+		total += (size_t)w * h * channels;
+		if (w == 1 && h == 1)
+			break;
+		w = std::max(1, w / 2);
+		h = std::max(1, h / 2);
+	}
+
+	levels.resize(total);
+	memcpy(levels.data(), pixels, (size_t)width * height * channels);
+	w = width;
+	h = height;
+	for (size_t level = 1; level < offsets.size(); ++level) {
+		Downsample(levels.data() + offsets[level - 1], w, h, channels, levels.data() + offsets[level]);
+		w = std::max(1, w / 2);
+		h = std::max(1, h / 2);
+	}
+}
+
+bool BakeDDS(const char *dds_file_path, const unsigned char *rgba, int width, int height, DDSFormat format)
+{
+	std::vector<unsigned char> levels;
+	std::vector<size_t> offsets;
+	BuildMipChain(rgba, width, height, 4, levels, offsets);
+
+	std::vector<unsigned char> blocks;
+	int w = width, h = height;
+	int mipCount = (int)offsets.size();
+	for (int level = 0; level < mipCount; ++level) {
+		size_t offset = blocks.size();
+		blocks.resize(offset + DDSLevelSize(format, w, h));
+		CompressImage(format, levels.data() + offsets[level], w, h, blocks.data() + offset);
+		w = std::max(1, w / 2);
+		h = std::max(1, h / 2);
+	}
+
+	DDSHeader header = {};
+	header.size = sizeof(DDSHeader);
+	header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header.height = (uint32_t)height;
+	header.width = (uint32_t)width;
+	header.pitchOrLinearSize = (uint32_t)DDSLevelSize(format, width, height);
+	header.mipMapCount = (uint32_t)mipCount;
+	header.pixelFormat.size = sizeof(DDSPixelFormat);
+	header.pixelFormat.flags = DDPF_FOURCC;
+	header.pixelFormat.fourCC = format == DDS_BC1 ? FOURCC_DXT1 : FOURCC_DXT5;
+	header.caps = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+	std::ofstream file(dds_file_path, std::ios::out | std::ios::binary);
+	if (!file.is_open())
+		return false;
+	file.write((const char *)&DDS_MAGIC, 4);
+	file.write((const char *)&header, sizeof(header));
+	file.write((const char *)blocks.data(), blocks.size());
+	return file.good();
+}
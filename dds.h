@@ -0,0 +1,54 @@
+#ifndef _DDS_H_
+#define _DDS_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Block-compressed textures stored in a DDS container.
+// BC1 (DXT1) packs a 4x4 RGB block into 8 bytes, BC3 (DXT5) packs RGBA into 16 bytes.
+// Nothing here touches OpenGL, so baking and the software fallback run without a GPU.
+
+enum DDSFormat {
+	DDS_BC1,
+	DDS_BC3
+};
+
+struct DDSImage {
+	DDSFormat format = DDS_BC1;
+	int width = 0;
+	int height = 0;
+	int mipCount = 0;
+	std::vector<size_t> mipOffsets;		// Offset of each level from data
+	std::vector<size_t> mipSizes;
+
+	const unsigned char *data = nullptr;	// Block data of all levels, back to back
+	size_t dataSize = 0;
+
+	// Owns the file contents when loaded with LoadDDS. Moving the image keeps data valid, copying does not.
+	std::vector<unsigned char> storage;
+};
+
+size_t DDSBlockBytes(DDSFormat format);
+size_t DDSLevelSize(DDSFormat format, int width, int height);
+
+// Parse a DDS file held in memory. The image points into bytes, which must outlive it.
+bool ParseDDS(const unsigned char *bytes, size_t size, DDSImage &image);
+bool LoadDDS(const char *dds_file_path, DDSImage &image);
+
+// Compress an RGBA8 image with a box-filtered mip chain and write it as DDS
+bool BakeDDS(const char *dds_file_path, const unsigned char *rgba, int width, int height, DDSFormat format);
+
+// Box-filtered mip chain of an 8 bit image with channels bytes per pixel. Every level down to 1x1
+// is written to levels back to back, level 0 a copy of pixels, and offsets gets where each one starts.
+void BuildMipChain(const unsigned char *pixels, int width, int height, int channels,
+	std::vector<unsigned char> &levels, std::vector<size_t> &offsets);
+
+// Single level encode/decode, images are RGBA8 with tightly packed rows
+void CompressImage(DDSFormat format, const unsigned char *rgba, int width, int height, unsigned char *blocks);
+void DecompressImage(DDSFormat format, const unsigned char *blocks, int width, int height, unsigned char *rgba);
+
+// Path of the baked sibling of a source image, e.g. facade3.jpg -> facade3.dds
+std::string BakedTexturePath(const std::string &texture_file_path);
+
+#endif
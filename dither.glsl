@@ -0,0 +1,8 @@
+// Ordered 4x4 dither threshold of this pixel. building.frag drops the pixels above it and
+// impostor.frag keeps exactly those, so the two fade into each other without overlapping.
+float ditherThreshold()
+{
+    const float bayer[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0, 3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+    return (bayer[pixel.y * 4 + pixel.x] + 0.5) / 16.0;
+}
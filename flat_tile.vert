@@ -0,0 +1,18 @@
+#version 330 core
+
+layout(location = 0) in vec3 vertexPosition;        // Vertex position
+layout(location = 1) in vec2 vertexUV;              // Texture coordinates
+
+// Per-instance input streamed every frame: tile centre in xyz, tile size in w
+layout(location = 3) in vec4 instancePositionScale;
+
+uniform mat4 VP;
+
+out vec2 uv;          // Pass UV coordinates to fragment shader
+
+void main() {
+    // Tiles are squares, so the model transform is a uniform scale followed by a translation
+    gl_Position = VP * vec4(instancePositionScale.xyz + vertexPosition * instancePositionScale.w, 1.0);
+
+    uv = vertexUV; // Pass UV coordinates
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+in vec2 uv;
+
+uniform vec3 tileColor;      // One colour for the whole tile
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(tileColor, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+in vec2 uv;
+
+uniform sampler2D texture1;
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = texture(texture1, uv);
+}
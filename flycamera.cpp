@@ -0,0 +1,86 @@
+#include "flycamera.h"
+#include "simulation.h"
+
+#include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+FlyCamera::FlyCamera(glm::vec3 position, glm::vec3 front, float yaw, float pitch, float speed)
+	: position(position), front(front), yaw(yaw), pitch(pitch), speed(speed)
+{
+}
+
+void FlyCamera::look(double xpos, double ypos)
+{
+	if (firstMouse) {
+		lastX = xpos;
+		lastY = ypos;
+		firstMouse = false;
+	}
+
+	float xoffset = float(xpos - lastX);
+	float yoffset = float(lastY - ypos); // Reversed since y-coordinates range from bottom to top
+	lastX = xpos;
+	lastY = ypos;
+
+	yaw += xoffset * sensitivity;
+	pitch += yoffset * sensitivity;
+
+	if (pitch > 89.0f)
+		pitch = 89.0f;
+	if (pitch < -89.0f)
+		pitch = -89.0f;
+
+	front = CameraFront(yaw, pitch);
+}
+
+glm::vec3 FlyCamera::moveDirection(bool forward, bool backward, bool left, bool right) const
+{
+	glm::vec3 direction(0.0f);
+	glm::vec3 side = glm::normalize(glm::cross(front, up));
+
+	if (forward)
+		direction += front;
+	if (backward)
+		direction -= front;
+	if (left)
+		direction -= side;
+	if (right)
+		direction += side;
+
+	if (glm::length(direction) > 0.0f)
+		return glm::normalize(direction);
+	return direction;
+}
+
+void FlyCamera::move(GLFWwindow *window)
+{
+	position += speed * moveDirection(glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS,
+		glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS,
+		glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS,
+		glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS);
+}
+
+glm::mat4 FlyCamera::view() const
+{
+	return glm::lookAt(position, position + front, up);
+}
+
+static void FlyCameraCursor(GLFWwindow *window, double xpos, double ypos)
+{
+	FlyCamera *camera = (FlyCamera *)glfwGetWindowUserPointer(window);
+	if (camera)
+		camera->look(xpos, ypos);
+}
+
+static void FlyCameraKey(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+		glfwSetWindowShouldClose(window, GLFW_TRUE);
+}
+
+void AttachFlyCamera(GLFWwindow *window, FlyCamera *camera)
+{
+	glfwSetWindowUserPointer(window, camera);
+	glfwSetCursorPosCallback(window, FlyCameraCursor);
+	glfwSetKeyCallback(window, FlyCameraKey);
+}
@@ -0,0 +1,42 @@
+#ifndef _FLYCAMERA_H_
+#define _FLYCAMERA_H_
+
+#include <glm/glm.hpp>
+
+struct GLFWwindow;
+
+// First person camera turned by the mouse and moved with WASD, shared by the scenes.
+// The front vector starts as given and follows yaw and pitch from the first look() on.
+struct FlyCamera {
+	glm::vec3 position;
+	glm::vec3 front;
+	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+	float yaw;
+	float pitch;
+	float speed;				// Distance covered by one move() call
+	float sensitivity = 0.1f;	// Degrees per pixel of cursor motion
+
+	FlyCamera(glm::vec3 position, glm::vec3 front, float yaw, float pitch, float speed);
+
+	// Turn by the cursor motion since the previous call, pitch stays within +-89 degrees
+	void look(double xpos, double ypos);
+
+	// Unit direction for the held movement keys, zero when none or opposing ones are held
+	glm::vec3 moveDirection(bool forward, bool backward, bool left, bool right) const;
+
+	// Step speed units along the WASD keys currently held in window
+	void move(GLFWwindow *window);
+
+	glm::mat4 view() const;
+
+private:
+	double lastX = 0.0;
+	double lastY = 0.0;
+	bool firstMouse = true;
+};
+
+// Send window's cursor motion to camera->look() and close the window on Escape.
+// Uses the window user pointer, so the scene must not set its own.
+void AttachFlyCamera(GLFWwindow *window, FlyCamera *camera);
+
+#endif
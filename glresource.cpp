@@ -0,0 +1,84 @@
+#include "glresource.h"
+
+void GLDeletionQueue::retire(GLObjectType type, GLuint name)
+{
+	retired[type].push_back(name);
+}
+
+void GLDeletionQueue::endFrame()
+{
+	// Delete the batches whose frames the GPU has finished, oldest first
+	while (!fenced.empty()) {
+		GLenum status = glClientWaitSync(fenced.front().fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(fenced.front().fence);
+		deleteNames(fenced.front().names);
+		fenced.pop_front();
+	}
+
+	bool any = false;
+	for (int type = 0; type < GLObjectTypeCount; ++type)
+		any = any || !retired[type].empty();
+	if (!any)
+		return;
+
+	// Commands submitted so far may still reference this frame's retired objects
+	fenced.emplace_back();
+	Batch &batch = fenced.back();
+	batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	for (int type = 0; type < GLObjectTypeCount; ++type)
+		batch.names[type].swap(retired[type]);
+}
+
+void GLDeletionQueue::flush()
+{
+	for (Batch &batch : fenced) {
+		glDeleteSync(batch.fence);
+		deleteNames(batch.names);
+	}
+	fenced.clear();
+	deleteNames(retired);
+}
+
+size_t GLDeletionQueue::pending() const
+{
+	size_t count = 0;
+	for (int type = 0; type < GLObjectTypeCount; ++type)
+		count += retired[type].size();
+	for (const Batch &batch : fenced)
+		for (int type = 0; type < GLObjectTypeCount; ++type)
+			count += batch.names[type].size();
+	return count;
+}
+
+void GLDeletionQueue::deleteNames(std::vector<GLuint> (&names)[GLObjectTypeCount])
+{
+	if (!names[GLBufferObject].empty())
+		glDeleteBuffers((GLsizei)names[GLBufferObject].size(), names[GLBufferObject].data());
+	if (!names[GLVertexArrayObject].empty())
+		glDeleteVertexArrays((GLsizei)names[GLVertexArrayObject].size(), names[GLVertexArrayObject].data());
+	if (!names[GLTextureObject].empty())
+		glDeleteTextures((GLsizei)names[GLTextureObject].size(), names[GLTextureObject].data());
+	if (!names[GLQueryObject].empty())
+		glDeleteQueries((GLsizei)names[GLQueryObject].size(), names[GLQueryObject].data());
+	if (!names[GLFramebufferObject].empty())
+		glDeleteFramebuffers((GLsizei)names[GLFramebufferObject].size(), names[GLFramebufferObject].data());
+	if (!names[GLRenderbufferObject].empty())
+		glDeleteRenderbuffers((GLsizei)names[GLRenderbufferObject].size(), names[GLRenderbufferObject].data());
+
+	// Programs have no batched delete
+	for (GLuint program : names[GLProgramObject])
+		glDeleteProgram(program);
+
+	for (int type = 0; type < GLObjectTypeCount; ++type) {
+		deletedCount += names[type].size();
+		names[type].clear();
+	}
+}
+
+GLDeletionQueue &DefaultDeletionQueue()
+{
+	static GLDeletionQueue *queue = new GLDeletionQueue();
+	return *queue;
+}
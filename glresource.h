@@ -0,0 +1,116 @@
+#ifndef _GLRESOURCE_H_
+#define _GLRESOURCE_H_
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+enum GLObjectType {
+	GLBufferObject,
+	GLVertexArrayObject,
+	GLTextureObject,
+	GLProgramObject,
+	GLQueryObject,
+	GLFramebufferObject,
+	GLRenderbufferObject,
+	GLObjectTypeCount
+};
+
+// Deletes GL objects once the GPU is done with every frame that could still use them.
+// Names retired during a frame are fenced at endFrame() and deleted, one glDelete* call
+// per type, on a later endFrame() after the fence has signalled. Nothing here blocks.
+class GLDeletionQueue {
+public:
+	// Safe to call without a context, e.g. from destructors: no GL call is made here
+	void retire(GLObjectType type, GLuint name);
+
+	// Call once per frame on the GL thread, after the frame's draws are submitted
+	void endFrame();
+
+	// Delete everything now, regardless of fences. Call before the context goes away.
+	void flush();
+
+	size_t pending() const;
+	unsigned long deleted() const { return deletedCount; }
+
+private:
+	struct Batch {
+		GLsync fence;
+		std::vector<GLuint> names[GLObjectTypeCount];
+	};
+
+	void deleteNames(std::vector<GLuint> (&names)[GLObjectTypeCount]);
+
+	std::vector<GLuint> retired[GLObjectTypeCount];		// Retired since the last endFrame()
+	std::deque<Batch> fenced;
+	unsigned long deletedCount = 0;
+};
+
+// Process-wide queue used by the GLObject wrappers. Never destroyed, so objects
+// released during static destruction still have somewhere to go.
+GLDeletionQueue &DefaultDeletionQueue();
+
+// Move-only owner of one GL object name. Destroying or resetting it retires the
+// name to DefaultDeletionQueue(), so copies can no longer delete the same object twice.
+template <GLObjectType Type>
+class GLObject {
+public:
+	GLObject() {}
+	explicit GLObject(GLuint name) : name(name) {}
+	~GLObject() { reset(); }
+
+	GLObject(GLObject &&other) noexcept : name(other.name) { other.name = 0; }
+	GLObject &operator=(GLObject &&other) noexcept
+	{
+		if (this != &other) {
+			reset();
+			name = other.name;
+			other.name = 0;
+		}
+		return *this;
+	}
+
+	GLObject(const GLObject&) = delete;
+	GLObject& operator=(const GLObject&) = delete;
+
+	// Programs come from LoadShadersFromFile, every other type can be generated here
+	static GLObject create()
+	{
+		GLuint generated = 0;
+		switch (Type) {
+			case GLBufferObject: glGenBuffers(1, &generated); break;
+			case GLVertexArrayObject: glGenVertexArrays(1, &generated); break;
+			case GLTextureObject: glGenTextures(1, &generated); break;
+			case GLQueryObject: glGenQueries(1, &generated); break;
+			case GLFramebufferObject: glGenFramebuffers(1, &generated); break;
+			case GLRenderbufferObject: glGenRenderbuffers(1, &generated); break;
+			default: break;
+		}
+		return GLObject(generated);
+	}
+
+	GLuint get() const { return name; }
+	explicit operator bool() const { return name != 0; }
+
+	void reset()
+	{
+		if (name)
+			DefaultDeletionQueue().retire(Type, name);
+		name = 0;
+	}
+
+private:
+	GLuint name = 0;
+};
+
+typedef GLObject<GLBufferObject> GLBuffer;
+typedef GLObject<GLVertexArrayObject> GLVertexArray;
+typedef GLObject<GLTextureObject> GLTexture;
+typedef GLObject<GLProgramObject> GLProgram;
+typedef GLObject<GLQueryObject> GLQuery;
+typedef GLObject<GLFramebufferObject> GLFramebuffer;
+typedef GLObject<GLRenderbufferObject> GLRenderbuffer;
+
+#endif
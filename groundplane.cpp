@@ -0,0 +1,118 @@
+#include "groundplane.h"
+#include "shader.h"
+
+#include <iostream>
+
+static const char *groundVertexShader = R"(
+#version 330 core
+out vec2 ndc;
+
+void main() {
+	// One triangle covering the screen, no vertex buffer needed
+	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	ndc = corner * 2.0 - 1.0;
+	gl_Position = vec4(ndc, 0.0, 1.0);
+}
+)";
+
+static const char *groundFragmentShader = R"(
+#version 330 core
+in vec2 ndc;
+out vec4 FragColor;
+
+uniform mat4 inverseViewProjection;
+uniform mat4 viewProjection;
+uniform vec3 cameraPosition;
+uniform float height;
+uniform vec3 groundColor;
+uniform vec3 lineColor;
+uniform float cellSize;
+uniform float lineWidth;
+uniform vec3 fogColor;
+uniform vec2 fade;
+
+void main() {
+	vec4 nearPoint = inverseViewProjection * vec4(ndc, -1.0, 1.0);
+	vec4 farPoint = inverseViewProjection * vec4(ndc, 1.0, 1.0);
+	vec3 origin = nearPoint.xyz / nearPoint.w;
+	vec3 direction = farPoint.xyz / farPoint.w - origin;
+
+	// Where the view ray meets the plane, as a fraction of the way from the near to the far plane
+	float t = (height - origin.y) / direction.y;
+	vec3 position = origin + t * direction;
+
+	// Take derivatives before discarding, while every pixel of the quad is still running
+	vec2 coord = position.xz / max(cellSize, 1e-4);
+	vec2 derivative = fwidth(coord);
+
+	// Also rejects rays parallel to the plane, where t is not a number
+	if (!(t > 0.0 && t <= 1.0))
+		discard;
+
+	// Distance to the nearest line in pixels, turned into coverage for a lineWidth wide line
+	vec2 grid = abs(fract(coord - 0.5) - 0.5) / derivative;
+	float line = 1.0 - clamp(min(grid.x, grid.y) - 0.5 * (lineWidth - 1.0), 0.0, 1.0);
+
+	// Lines closer together than a few pixels would only alias, fade them out instead
+	line *= 1.0 - smoothstep(0.2, 0.5, max(derivative.x, derivative.y));
+	if (cellSize <= 0.0)
+		line = 0.0;
+
+	vec3 color = mix(groundColor, lineColor, line);
+	color = mix(color, fogColor, smoothstep(fade.x, fade.y, length(position - cameraPosition)));
+	FragColor = vec4(color, 1.0);
+
+	vec4 clip = viewProjection * vec4(position, 1.0);
+	gl_FragDepth = (gl_DepthRange.diff * clip.z / clip.w + gl_DepthRange.near + gl_DepthRange.far) * 0.5;
+}
+)";
+
+void GroundPlane::initialize()
+{
+	program = GLProgram(LoadShadersFromString(groundVertexShader, groundFragmentShader));
+	if (!program)
+		std::cerr << "Failed to load ground plane shaders." << std::endl;
+
+	inverseViewProjectionID = glGetUniformLocation(program.get(), "inverseViewProjection");
+	viewProjectionID = glGetUniformLocation(program.get(), "viewProjection");
+	cameraPositionID = glGetUniformLocation(program.get(), "cameraPosition");
+	heightID = glGetUniformLocation(program.get(), "height");
+	groundColorID = glGetUniformLocation(program.get(), "groundColor");
+	lineColorID = glGetUniformLocation(program.get(), "lineColor");
+	cellSizeID = glGetUniformLocation(program.get(), "cellSize");
+	lineWidthID = glGetUniformLocation(program.get(), "lineWidth");
+	fogColorID = glGetUniformLocation(program.get(), "fogColor");
+	fadeID = glGetUniformLocation(program.get(), "fade");
+
+	// Core profile needs a vertex array bound to draw, even with no attributes
+	vertexArray = GLVertexArray::create();
+}
+
+void GroundPlane::cleanup()
+{
+	vertexArray.reset();
+	program.reset();
+}
+
+void GroundPlane::render(const glm::mat4 &view, const glm::mat4 &projection, const GroundPlaneStyle &style)
+{
+	glm::mat4 viewProjection = projection * view;
+	glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(view)[3]);
+
+	glUseProgram(program.get());
+	glUniformMatrix4fv(inverseViewProjectionID, 1, GL_FALSE, &inverseViewProjection[0][0]);
+	glUniformMatrix4fv(viewProjectionID, 1, GL_FALSE, &viewProjection[0][0]);
+	glUniform3fv(cameraPositionID, 1, &cameraPosition[0]);
+	glUniform1f(heightID, style.height);
+	glUniform3fv(groundColorID, 1, &style.groundColor[0]);
+	glUniform3fv(lineColorID, 1, &style.lineColor[0]);
+	glUniform1f(cellSizeID, style.cellSize);
+	glUniform1f(lineWidthID, style.lineWidth);
+	glUniform3fv(fogColorID, 1, &style.fogColor[0]);
+	glUniform2f(fadeID, style.fadeStart, style.fadeEnd);
+
+	glBindVertexArray(vertexArray.get());
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+}
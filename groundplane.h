@@ -0,0 +1,46 @@
+#ifndef _GROUNDPLANE_H_
+#define _GROUNDPLANE_H_
+
+#include "glresource.h"
+#include <glm/glm.hpp>
+
+// Look of the ground plane. Colours are linear RGB.
+struct GroundPlaneStyle {
+	float height = 0.0f;							// y of the plane
+	glm::vec3 groundColor = glm::vec3(0.1f, 0.3f, 0.2f);
+	glm::vec3 lineColor = glm::vec3(0.2f, 0.45f, 0.3f);
+	float cellSize = 10.0f;							// Spacing of the grid lines, 0 for none
+	float lineWidth = 1.5f;							// In pixels
+	glm::vec3 fogColor = glm::vec3(0.53f, 0.81f, 0.92f);	// Usually the clear colour
+	float fadeStart = 60.0f;						// Distance from the camera where fog begins
+	float fadeEnd = 100.0f;							// and where it hides the plane; keep it inside the far plane
+};
+
+// Infinite horizontal plane drawn as one full-screen triangle. Each pixel intersects its view
+// ray with the plane, shades the hit with anti-aliased grid lines and distance fog, and writes
+// the hit's depth, so other geometry still sorts against it. There are no tiles to stream.
+// The program and vertex array are GLObjects, released with the plane or by cleanup().
+struct GroundPlane {
+	GLProgram program;
+	GLVertexArray vertexArray;
+
+	void initialize();
+	void cleanup();
+
+	// Draw before or after the scene's opaque geometry, with depth testing on
+	void render(const glm::mat4 &view, const glm::mat4 &projection, const GroundPlaneStyle &style = GroundPlaneStyle());
+
+private:
+	GLint inverseViewProjectionID = -1;
+	GLint viewProjectionID = -1;
+	GLint cameraPositionID = -1;
+	GLint heightID = -1;
+	GLint groundColorID = -1;
+	GLint lineColorID = -1;
+	GLint cellSizeID = -1;
+	GLint lineWidthID = -1;
+	GLint fogColorID = -1;
+	GLint fadeID = -1;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#version 330 core
+
+in vec3 atlasCoord0;
+in vec3 atlasCoord1;
+in float viewBlend;
+in vec3 FragPos;
+flat in float fade;
+
+uniform sampler2DArray albedoAtlas;     // Facade colour, alpha marks the building's silhouette
+uniform sampler2DArray normalAtlas;     // World space normals, packed into 0 to 1
+uniform vec3 lightColor;
+
+#include "shadow.glsl"
+#include "dither.glsl"
+
+out vec4 finalColor;
+
+void main()
+{
+    if (ditherThreshold() <= fade)
+        discard;
+
+    vec4 albedo = mix(texture(albedoAtlas, atlasCoord0), texture(albedoAtlas, atlasCoord1), viewBlend);
+    if (albedo.a < 0.5)
+        discard;
+
+    // Lit like building.frag, at the quad instead of the box surface
+    vec3 ambient = 0.1 * lightColor;
+
+    vec3 norm = normalize(mix(texture(normalAtlas, atlasCoord0).xyz, texture(normalAtlas, atlasCoord1).xyz, viewBlend) * 2.0 - 1.0);
+    vec3 lightDir = towardsLight.xyz;
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightColor * sunVisibility(FragPos, norm);
+
+    finalColor = vec4((ambient + diffuse) * albedo.rgb, 1.0);
+}
@@ -0,0 +1,48 @@
+#version 330 core
+
+// Input
+layout(location = 0) in vec2 corner;    // Quad corner, -1 to 1 on both axes
+
+// Per-instance input, one record per distant building
+layout(location = 1) in vec3 instancePosition;
+layout(location = 2) in vec3 instanceScale;
+layout(location = 3) in float instanceLayer;    // Atlas layer of the building's archetype
+
+out vec3 atlasCoord0;   // The two baked views either side of the camera's direction
+out vec3 atlasCoord1;
+out float viewBlend;
+out vec3 FragPos;
+flat out float fade;
+
+// Per-frame uniforms shared with the tile and building programs
+layout(std140) uniform FrameData {
+    mat4 VP;
+    vec4 eye;
+    vec4 lodRange;
+};
+
+const float views = 8.0;    // Views baked around each archetype, see ImpostorRenderer
+
+void main() {
+    // The quad turns about the vertical axis to face the camera
+    vec2 toEye = eye.xz - instancePosition.xz;
+    float distance = length(toEye);
+    vec2 direction = distance > 0.0 ? toEye / distance : vec2(0.0, 1.0);
+    vec3 right = vec3(direction.y, 0.0, -direction.x);
+
+    // Wide enough for the box seen across its diagonal
+    float halfWidth = max(instanceScale.x, instanceScale.z) * 1.41421356;
+    FragPos = instancePosition + right * (corner.x * halfWidth) + vec3(0.0, corner.y * instanceScale.y, 0.0);
+    gl_Position = VP * vec4(FragPos, 1.0);
+
+    // View k was baked from azimuth k / views of a turn, measured from +z towards +x
+    float view = mod(atan(direction.x, direction.y) / 6.28318531 * views + views, views);
+    float first = floor(view);
+    viewBlend = view - first;
+
+    vec2 uv = corner * 0.5 + 0.5;
+    atlasCoord0 = vec3((first + uv.x) / views, uv.y, instanceLayer);
+    atlasCoord1 = vec3((mod(first + 1.0, views) + uv.x) / views, uv.y, instanceLayer);
+
+    fade = 1.0 - clamp((distance - lodRange.x) / (lodRange.y - lodRange.x), 0.0, 1.0);
+}
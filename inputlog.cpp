@@ -0,0 +1,274 @@
+#include "inputlog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+struct InputLogHeader {
+	uint32_t magic;			// "INPL"
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t seed;
+};
+
+static const uint32_t inputLogMagic = 0x4c504e49;
+static const uint16_t inputLogVersion = 3;	// Version 2 had no end marker, version 1 counted frames instead of ticks
+static const uint8_t endMarkerTag = 0x80;
+
+// Recorded bytes are written out in blocks of this size
+static const size_t flushBytes = 64 * 1024;
+
+// Highest key code tracked, GLFW_KEY_LAST is 348
+static const int maxKey = 512;
+
+static void PutVarint(std::vector<uint8_t> &out, uint64_t value)
+{
+	while (value >= 0x80) {
+		out.push_back(uint8_t(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(uint8_t(value));
+}
+
+static bool GetVarint(const uint8_t *&cursor, const uint8_t *end, uint64_t &value)
+{
+	value = 0;
+	for (int shift = 0; cursor < end && shift < 64; shift += 7) {
+		uint8_t byte = *cursor++;
+		value |= uint64_t(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+InputLog::~InputLog()
+{
+	stop();
+}
+
+bool InputLog::startRecording(const char *log_file_path, unsigned int seed)
+{
+	stop();
+
+	file = fopen(log_file_path, "wb");
+	if (!file) {
+		std::cerr << "Failed to create input log " << log_file_path << std::endl;
+		return false;
+	}
+
+	InputLogHeader header = {inputLogMagic, inputLogVersion, 0, seed};
+	fwrite(&header, sizeof(header), 1, file);
+
+	mode = Recording;
+	sessionSeed = seed;
+	currentTick = 0;
+	startTime = std::chrono::steady_clock::now();
+	lastTickWritten = 0;
+	lastTimeWritten = 0;
+	return true;
+}
+
+bool InputLog::startReplay(const char *log_file_path)
+{
+	stop();
+
+	FILE *input = fopen(log_file_path, "rb");
+	if (!input) {
+		std::cerr << "Failed to open input log " << log_file_path << std::endl;
+		return false;
+	}
+	std::vector<uint8_t> bytes;
+	uint8_t block[4096];
+	size_t count;
+	while ((count = fread(block, 1, sizeof(block), input)) > 0)
+		bytes.insert(bytes.end(), block, block + count);
+	fclose(input);
+
+	InputLogHeader header;
+	if (bytes.size() < sizeof(header)) {
+		std::cerr << "Input log " << log_file_path << " is truncated" << std::endl;
+		return false;
+	}
+	memcpy(&header, bytes.data(), sizeof(header));
+	if (header.magic != inputLogMagic || (header.version != inputLogVersion && header.version != 2)) {
+		std::cerr << "Input log " << log_file_path << " has an unsupported format" << std::endl;
+		return false;
+	}
+
+	events.clear();
+	const uint8_t *cursor = bytes.data() + sizeof(header);
+	const uint8_t *end = bytes.data() + bytes.size();
+	Event event = {};
+	bool ended = false;
+	while (cursor < end) {
+		uint8_t tag = *cursor++;
+		uint64_t tickDelta, timeDelta;
+		if (!GetVarint(cursor, end, tickDelta) || !GetVarint(cursor, end, timeDelta))
+			break;
+
+		event.tick += uint32_t(tickDelta);
+		event.timeUs += timeDelta;
+		if (tag == endMarkerTag) {
+			endTick = event.tick;
+			ended = true;
+			break;
+		}
+		event.type = tag & 1;
+		event.action = (tag >> 1) & 3;
+
+		if (event.type == EventKey) {
+			uint64_t key;
+			if (!GetVarint(cursor, end, key))
+				break;
+			event.key = int(key) - 1;
+		} else {
+			if (end - cursor < 8)
+				break;
+			memcpy(&event.x, cursor, 4);
+			memcpy(&event.y, cursor + 4, 4);
+			cursor += 8;
+		}
+		events.push_back(event);
+	}
+	if (cursor < end && !ended)
+		std::cerr << "Input log " << log_file_path << " ends in a partial record, replaying what was read" << std::endl;
+
+	// Without an end marker (version 2, or a session that crashed) stop after the last event
+	if (!ended)
+		endTick = events.empty() ? 0 : events.back().tick + 1;
+
+	mode = Replaying;
+	sessionSeed = header.seed;
+	currentTick = 0;
+	nextEvent = 0;
+	keysDown.assign(maxKey, false);
+	return true;
+}
+
+void InputLog::stop()
+{
+	if (mode == Recording) {
+		writeEnd();
+		flush();
+		fclose(file);
+		file = nullptr;
+	}
+	mode = Idle;
+}
+
+void InputLog::beginTick()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	currentTick++;
+
+	// Everything that arrived after earlier ticks is due now
+	while (nextEvent < events.size() && events[nextEvent].tick < currentTick)
+		apply(events[nextEvent++]);
+
+	// Live events are only queued until they are applied
+	if (mode != Replaying && nextEvent == events.size()) {
+		events.clear();
+		nextEvent = 0;
+	}
+}
+
+bool InputLog::replayFinished()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return mode == Replaying && currentTick >= endTick;
+}
+
+void InputLog::keyEvent(int key, int action)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (mode == Replaying)
+		return;
+
+	Event event = {};
+	event.type = EventKey;
+	event.key = key;
+	event.action = uint8_t(action & 3);
+	record(event);
+}
+
+void InputLog::cursorEvent(double xpos, double ypos)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (mode == Replaying)
+		return;
+
+	// Recorded positions are floats, so the scene gets the same rounded values that a replay will
+	Event event = {};
+	event.type = EventCursor;
+	event.x = float(xpos);
+	event.y = float(ypos);
+	record(event);
+}
+
+bool InputLog::isKeyDown(int key) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return key >= 0 && key < (int)keysDown.size() && keysDown[key];
+}
+
+void InputLog::apply(const Event &event)
+{
+	if (event.type == EventKey) {
+		if (event.key < 0 || event.key >= maxKey)
+			return;
+		if (keysDown.empty())
+			keysDown.assign(maxKey, false);
+		keysDown[event.key] = event.action != 0;	// Press and repeat both hold the key down
+	} else if (cursorHandler) {
+		cursorHandler(event.x, event.y);
+	}
+}
+
+void InputLog::record(Event event)
+{
+	event.tick = currentTick;
+	events.push_back(event);
+	if (mode != Recording)
+		return;
+
+	event.timeUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+
+	encoded.push_back(uint8_t(event.type | (event.action << 1)));
+	PutVarint(encoded, event.tick - lastTickWritten);
+	PutVarint(encoded, event.timeUs - lastTimeWritten);
+	lastTickWritten = event.tick;
+	lastTimeWritten = event.timeUs;
+
+	if (event.type == EventKey) {
+		PutVarint(encoded, uint64_t(event.key + 1));	// GLFW_KEY_UNKNOWN is -1
+	} else {
+		uint8_t position[8];
+		memcpy(position, &event.x, 4);
+		memcpy(position + 4, &event.y, 4);
+		encoded.insert(encoded.end(), position, position + 8);
+	}
+
+	if (encoded.size() >= flushBytes)
+		flush();
+}
+
+// Marks the last tick the session ran, after any events that arrived after it
+void InputLog::writeEnd()
+{
+	uint64_t timeUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+	uint32_t tick = std::max(currentTick, lastTickWritten);
+
+	encoded.push_back(endMarkerTag);
+	PutVarint(encoded, tick - lastTickWritten);
+	PutVarint(encoded, timeUs - lastTimeWritten);
+	lastTickWritten = tick;
+	lastTimeWritten = timeUs;
+}
+
+void InputLog::flush()
+{
+	if (file && !encoded.empty())
+		fwrite(encoded.data(), 1, encoded.size(), file);
+	encoded.clear();
+}
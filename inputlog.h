@@ -0,0 +1,106 @@
+#ifndef _INPUTLOG_H_
+#define _INPUTLOG_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+// Key and cursor input of a session, recorded to or replayed from a binary log.
+// The scene reads keys through isKeyDown() and receives cursor moves through the
+// cursor handler instead of querying GLFW, so a replayed session drives the camera
+// exactly like the live one did.
+//
+// Events are stamped with the simulation tick they arrived after and the time since the
+// session started. Live and replayed events take the same route: an event that arrives
+// after tick N is applied at the start of tick N + 1, so a replay is tick exact whatever
+// the frame times of the replaying run are. Events may arrive on the window thread while
+// ticks run on the simulation thread.
+//
+// Log layout (little endian):
+//   InputLogHeader
+//   records, each: tag byte (event type, key action in the high bits),
+//                  varint tick delta, varint time delta in microseconds,
+//                  then a varint key code + 1 for keys, or two floats for the cursor
+//   end marker:    tag byte 0x80, varint tick delta to the last tick the session ran,
+//                  varint time delta. A replay runs until that tick, so input held
+//                  after the last event still moves the camera for as long as it did.
+class InputLog {
+public:
+	typedef void (*CursorHandler)(double xpos, double ypos);
+
+	InputLog() {}
+	~InputLog();
+
+	InputLog(const InputLog&) = delete;
+	InputLog& operator=(const InputLog&) = delete;
+
+	// The seed of the recorded session is stored so a replay regenerates the same city.
+	// Start and stop while no ticks are running.
+	bool startRecording(const char *log_file_path, unsigned int seed);
+	bool startReplay(const char *log_file_path);
+	void stop();
+
+	// Call at the top of every simulation tick. Applies the events due before this tick.
+	void beginTick();
+
+	// Live events from the GLFW callbacks. Ignored while replaying.
+	void keyEvent(int key, int action);
+	void cursorEvent(double xpos, double ypos);
+
+	// Key state as of the current tick
+	bool isKeyDown(int key) const;
+
+	void setCursorHandler(CursorHandler handler) { cursorHandler = handler; }
+
+	bool recording() const { return mode == Recording; }
+	bool replaying() const { return mode == Replaying; }
+	bool replayFinished();
+
+	unsigned int seed() const { return sessionSeed; }
+	size_t eventCount() const { return events.size(); }
+
+	// Ticks spanned by the replayed log
+	uint32_t lastTick() const { return endTick; }
+
+private:
+	enum Mode { Idle, Recording, Replaying };
+
+	enum EventType : uint8_t { EventKey = 0, EventCursor = 1 };
+
+	struct Event {
+		uint32_t tick;
+		uint64_t timeUs;
+		uint8_t type;
+		uint8_t action;
+		int key;
+		float x, y;
+	};
+
+	void apply(const Event &event);
+	void record(Event event);
+	void flush();
+	void writeEnd();
+
+	mutable std::mutex mutex;
+
+	Mode mode = Idle;
+	FILE *file = nullptr;
+	unsigned int sessionSeed = 0;
+
+	uint32_t currentTick = 0;
+	uint32_t endTick = 0;				// Replay: finished once this tick has run
+	std::chrono::steady_clock::time_point startTime;
+
+	std::vector<bool> keysDown;
+	CursorHandler cursorHandler = nullptr;
+
+	std::vector<Event> events;			// Replay: the whole decoded log. Live: events not applied yet.
+	size_t nextEvent = 0;
+	std::vector<uint8_t> encoded;		// Recording: bytes not yet written
+	uint32_t lastTickWritten = 0;
+	uint64_t lastTimeWritten = 0;
+};
+
+#endif
@@ -3,19 +3,18 @@
 layout(location = 0) in vec3 vertexPosition;        // Vertex position
 layout(location = 1) in vec2 vertexUV;              // Texture coordinates
 layout(location = 2) in vec3 vertexNormal;          // Normal coordinates
+layout(location = 3) in vec4 instancePositionScale; // Per tile: centre in xyz, size in w
 
-uniform mat4 MVP;
-uniform mat4 model; 
+uniform mat4 VP;
 
 out vec2 uv;          // Pass UV coordinates to fragment shader
 out vec3 FragPos;     // Pass world position to fragment shader
 out vec3 Normal;      // Pass transformed normals to fragment shader
 
 void main() {
-    gl_Position = MVP * vec4(vertexPosition, 1.0);
-
-    // Calculate world position
-    FragPos = vec3(model * vec4(vertexPosition, 1.0)); 
+    // Calculate world position, tiles are only scaled and moved
+    FragPos = instancePositionScale.xyz + vertexPosition * instancePositionScale.w;
+    gl_Position = VP * vec4(FragPos, 1.0);
 
     // Transform normals
    // Normal = mat3(transpose(inverse(model))) * vertexNormal; 
@@ -0,0 +1,41 @@
+#include "noise.h"
+
+#include <cmath>
+
+unsigned int LatticeHash(int x, int y, unsigned int seed)
+{
+	unsigned int hashed = seed + 3251 * x + 8741 * y;
+	hashed = (hashed << 13) ^ hashed;
+	return (hashed * (hashed * hashed * 15731 + 789221) + 1376312589) & 0x7fffffff;
+}
+
+static float lerp(float a, float b, float t)
+{
+	return a + t * (b - a);
+}
+
+static float fade(float t)
+{
+	return t * t * t * (t * (t * 6 - 15) + 10);
+}
+
+static float dotGridGradient(int ix, int iy, float x, float y, unsigned int seed)
+{
+	float angle = (LatticeHash(ix, iy, seed) % 360) * (3.14159265f / 180.0f);
+	return std::cos(angle) * (x - (float)ix) + std::sin(angle) * (y - (float)iy);
+}
+
+float GradientNoise2D(float x, float y, unsigned int seed)
+{
+	int x0 = (int)std::floor(x);
+	int x1 = x0 + 1;
+	int y0 = (int)std::floor(y);
+	int y1 = y0 + 1;
+
+	float sx = fade(x - (float)x0);
+	float sy = fade(y - (float)y0);
+
+	float ix0 = lerp(dotGridGradient(x0, y0, x, y, seed), dotGridGradient(x1, y0, x, y, seed), sx);
+	float ix1 = lerp(dotGridGradient(x0, y1, x, y, seed), dotGridGradient(x1, y1, x, y, seed), sx);
+	return lerp(ix0, ix1, sy);
+}
@@ -0,0 +1,11 @@
+#ifndef _NOISE_H_
+#define _NOISE_H_
+
+// Stateless hash of a lattice point, in [0, 2^31). Anything derived from it can be regenerated
+// for one cell or chunk on its own, on any thread, and still agree with its neighbours.
+unsigned int LatticeHash(int x, int y, unsigned int seed);
+
+// Gradient (Perlin) noise in roughly [-1, 1], with one gradient per integer lattice point
+float GradientNoise2D(float x, float y, unsigned int seed = 12345);
+
+#endif
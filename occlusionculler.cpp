@@ -0,0 +1,322 @@
+#include "occlusionculler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_SSE 1
+#endif
+
+// Corners of the box in bit order: bit 0 picks +x, bit 1 +y and bit 2 +z
+static void boxCorners(const glm::mat4 &viewProjection, const glm::vec3 &center, const glm::vec3 &halfExtents, glm::vec4 clip[8])
+{
+	for (int i = 0; i < 8; ++i) {
+		glm::vec3 corner = center + halfExtents * glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+		clip[i] = viewProjection * glm::vec4(corner, 1.0f);
+	}
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+OcclusionCuller::OcclusionCuller(int width, int height, unsigned int threadCount)
+	: workers(threadCount)
+{
+	blocksX = (width + blockSize - 1) / blockSize;
+	blocksY = (height + blockSize - 1) / blockSize;
+	bufferWidth = blocksX * blockSize;
+	bufferHeight = blocksY * blockSize;
+	depthBuffer.assign(bufferWidth * bufferHeight, 1.0f);
+	blockDepth.assign(blocksX * blocksY, 1.0f);
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4 &viewProjection, const glm::vec3 &eye)
+{
+	this->viewProjection = viewProjection;
+	this->eye = eye;
+	triangles.clear();
+
+	occluders = 0;
+	tested = 0;
+	outsideView = 0;
+	occluded = 0;
+	rasterMs = 0.0;
+	testMs = 0.0;
+}
+
+void OcclusionCuller::addOccluder(const glm::vec3 &center, const glm::vec3 &halfExtents)
+{
+	glm::vec4 clip[8];
+	boxCorners(viewProjection, center, halfExtents, clip);
+
+	// Clipping against the near plane is not worth it for an occluder, just leave it out
+	glm::vec3 screen[8];
+	for (int i = 0; i < 8; ++i) {
+		if (clip[i].z < -clip[i].w || clip[i].w <= 0.0f)
+			return;
+		float inverseW = 1.0f / clip[i].w;
+		screen[i] = glm::vec3((clip[i].x * inverseW * 0.5f + 0.5f) * bufferWidth,
+			(clip[i].y * inverseW * 0.5f + 0.5f) * bufferHeight,
+			clip[i].z * inverseW * 0.5f + 0.5f);
+	}
+	occluders++;
+
+	// Only the faces turned towards the eye can be nearest, at most three of the six
+	for (int axis = 0; axis < 3; ++axis) {
+		int u = (axis + 1) % 3;
+		int v = (axis + 2) % 3;
+		for (int side = 0; side < 2; ++side) {
+			float outside = side ? eye[axis] - center[axis] : center[axis] - eye[axis];
+			if (outside <= halfExtents[axis])
+				continue;
+
+			int base = side << axis;
+			int quad[4] = { base, base | (1 << u), base | (1 << u) | (1 << v), base | (1 << v) };
+			for (int half = 0; half < 2; ++half) {
+				int a = quad[0], b = quad[half + 1], c = quad[half + 2];
+				Triangle triangle;
+				const int corners[3] = { a, b, c };
+				float minY = bufferHeight, maxY = 0.0f;
+				for (int k = 0; k < 3; ++k) {
+					triangle.x[k] = screen[corners[k]].x;
+					triangle.y[k] = screen[corners[k]].y;
+					triangle.z[k] = screen[corners[k]].z;
+					minY = std::min(minY, triangle.y[k]);
+					maxY = std::max(maxY, triangle.y[k]);
+				}
+				triangle.minY = std::max(0, (int)std::floor(minY));
+				triangle.maxY = std::min(bufferHeight - 1, (int)std::ceil(maxY));
+				if (triangle.minY <= triangle.maxY)
+					triangles.push_back(triangle);
+			}
+		}
+	}
+}
+
+void OcclusionCuller::rasterize()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// Bands are whole rows of blocks, so each band also builds its own part of the hierarchy
+	int bands = std::max(1, std::min(blocksY, (int)workers.size() * 2));
+	int blockRowsPerBand = (blocksY + bands - 1) / bands;
+	for (int firstBlockRow = 0; firstBlockRow < blocksY; firstBlockRow += blockRowsPerBand) {
+		int firstRow = firstBlockRow * blockSize;
+		int endRow = std::min(blocksY, firstBlockRow + blockRowsPerBand) * blockSize;
+		workers.submit([this, firstRow, endRow]() {
+			rasterizeBand(firstRow, endRow);
+		});
+	}
+	workers.waitIdle();
+
+	rasterMs = millisecondsSince(start);
+}
+
+void OcclusionCuller::rasterizeBand(int firstRow, int endRow)
+{
+	std::fill(depthBuffer.begin() + firstRow * bufferWidth, depthBuffer.begin() + endRow * bufferWidth, 1.0f);
+
+	for (const Triangle &triangle : triangles) {
+		if (triangle.maxY >= firstRow && triangle.minY < endRow)
+			rasterizeTriangle(triangle, firstRow, endRow);
+	}
+
+	for (int by = firstRow / blockSize; by < endRow / blockSize; ++by) {
+		for (int bx = 0; bx < blocksX; ++bx) {
+			float farthest = 0.0f;
+			for (int y = by * blockSize; y < (by + 1) * blockSize; ++y) {
+				const float *row = &depthBuffer[y * bufferWidth + bx * blockSize];
+				for (int x = 0; x < blockSize; ++x)
+					farthest = std::max(farthest, row[x]);
+			}
+			blockDepth[by * blocksX + bx] = farthest;
+		}
+	}
+}
+
+void OcclusionCuller::rasterizeTriangle(const Triangle &triangle, int firstRow, int endRow)
+{
+	float x0 = triangle.x[0], y0 = triangle.y[0];
+	float x1 = triangle.x[1], y1 = triangle.y[1];
+	float x2 = triangle.x[2], y2 = triangle.y[2];
+	float z0 = triangle.z[0], z1 = triangle.z[1], z2 = triangle.z[2];
+
+	float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+	if (std::fabs(area) < 1e-6f)
+		return;
+
+	// Make the edge functions positive inside whichever way the triangle winds
+	if (area < 0.0f) {
+		std::swap(x1, x2);
+		std::swap(y1, y2);
+		std::swap(z1, z2);
+		area = -area;
+	}
+
+	// Depth is linear in screen space
+	float dzdx = ((z1 - z0) * (y2 - y0) - (z2 - z0) * (y1 - y0)) / area;
+	float dzdy = ((z2 - z0) * (x1 - x0) - (z1 - z0) * (x2 - x0)) / area;
+
+	int minX = std::max(0, (int)std::floor(std::min(x0, std::min(x1, x2))));
+	int maxX = std::min(bufferWidth - 1, (int)std::ceil(std::max(x0, std::max(x1, x2))));
+	int minY = std::max(firstRow, triangle.minY);
+	int maxY = std::min(endRow - 1, triangle.maxY);
+	if (minX > maxX)
+		return;
+
+	// Edge functions at pixel centres, each the signed area opposite one vertex, and their steps along a row
+	float stepX0 = y1 - y2;
+	float stepX1 = y2 - y0;
+	float stepX2 = y0 - y1;
+
+	minX &= ~3;
+	for (int y = minY; y <= maxY; ++y) {
+		float px = minX + 0.5f;
+		float py = y + 0.5f;
+		float e0 = (x2 - x1) * (py - y1) - (y2 - y1) * (px - x1);
+		float e1 = (x0 - x2) * (py - y2) - (y0 - y2) * (px - x2);
+		float e2 = (x1 - x0) * (py - y0) - (y1 - y0) * (px - x0);
+		float z = z0 + dzdx * (px - x0) + dzdy * (py - y0);
+		float *row = &depthBuffer[y * bufferWidth];
+
+#ifdef OCCLUSION_SSE
+		const __m128 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+		const __m128 zero = _mm_setzero_ps();
+		__m128 edge0 = _mm_add_ps(_mm_set1_ps(e0), _mm_mul_ps(lane, _mm_set1_ps(stepX0)));
+		__m128 edge1 = _mm_add_ps(_mm_set1_ps(e1), _mm_mul_ps(lane, _mm_set1_ps(stepX1)));
+		__m128 edge2 = _mm_add_ps(_mm_set1_ps(e2), _mm_mul_ps(lane, _mm_set1_ps(stepX2)));
+		__m128 depth = _mm_add_ps(_mm_set1_ps(z), _mm_mul_ps(lane, _mm_set1_ps(dzdx)));
+		const __m128 step0 = _mm_set1_ps(4.0f * stepX0);
+		const __m128 step1 = _mm_set1_ps(4.0f * stepX1);
+		const __m128 step2 = _mm_set1_ps(4.0f * stepX2);
+		const __m128 stepZ = _mm_set1_ps(4.0f * dzdx);
+
+		for (int x = minX; x <= maxX; x += 4) {
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)), _mm_cmpge_ps(edge2, zero));
+			if (_mm_movemask_ps(inside)) {
+				__m128 stored = _mm_loadu_ps(row + x);
+				__m128 nearest = _mm_min_ps(stored, depth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored)));
+			}
+			edge0 = _mm_add_ps(edge0, step0);
+			edge1 = _mm_add_ps(edge1, step1);
+			edge2 = _mm_add_ps(edge2, step2);
+			depth = _mm_add_ps(depth, stepZ);
+		}
+#else
+		for (int x = minX; x <= maxX; ++x) {
+			if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f)
+				row[x] = std::min(row[x], z);
+			e0 += stepX0;
+			e1 += stepX1;
+			e2 += stepX2;
+			z += dzdx;
+		}
+#endif
+	}
+}
+
+OcclusionCuller::Result OcclusionCuller::test(const glm::vec3 &center, const glm::vec3 &halfExtents) const
+{
+	glm::vec4 clip[8];
+	boxCorners(viewProjection, center, halfExtents, clip);
+
+	int behind = 0;
+	glm::vec3 low(1e30f), high(-1e30f);
+	for (int i = 0; i < 8; ++i) {
+		if (clip[i].w <= 0.0f) {
+			behind++;
+			continue;
+		}
+		glm::vec3 ndc = glm::vec3(clip[i]) / clip[i].w;
+		low = glm::min(low, ndc);
+		high = glm::max(high, ndc);
+	}
+	if (behind == 8)
+		return OutsideView;
+
+	// Boxes crossing the eye plane have no usable screen rectangle
+	if (behind > 0)
+		return Visible;
+	if (high.x < -1.0f || low.x > 1.0f || high.y < -1.0f || low.y > 1.0f || high.z < -1.0f || low.z > 1.0f)
+		return OutsideView;
+	if (low.z < -1.0f)
+		return Visible;
+
+	int x0 = std::max(0, (int)std::floor((low.x * 0.5f + 0.5f) * bufferWidth));
+	int x1 = std::min(bufferWidth - 1, (int)std::floor((high.x * 0.5f + 0.5f) * bufferWidth));
+	int y0 = std::max(0, (int)std::floor((low.y * 0.5f + 0.5f) * bufferHeight));
+	int y1 = std::min(bufferHeight - 1, (int)std::floor((high.y * 0.5f + 0.5f) * bufferHeight));
+	float nearest = low.z * 0.5f + 0.5f;
+
+	// Whole blocks behind which everything is nearer than the box are settled by the hierarchy,
+	// the pixels of the others are checked one by one
+	for (int by = y0 / blockSize; by <= y1 / blockSize; ++by) {
+		for (int bx = x0 / blockSize; bx <= x1 / blockSize; ++bx) {
+			if (blockDepth[by * blocksX + bx] < nearest)
+				continue;
+
+			int rowEnd = std::min(y1, (by + 1) * blockSize - 1);
+			int columnEnd = std::min(x1, (bx + 1) * blockSize - 1);
+			for (int y = std::max(y0, by * blockSize); y <= rowEnd; ++y) {
+				const float *row = &depthBuffer[y * bufferWidth];
+				for (int x = std::max(x0, bx * blockSize); x <= columnEnd; ++x) {
+					if (row[x] >= nearest)
+						return Visible;
+				}
+			}
+		}
+	}
+	return Occluded;
+}
+
+bool OcclusionCuller::visible(const glm::vec3 &center, const glm::vec3 &halfExtents) const
+{
+	return test(center, halfExtents) == Visible;
+}
+
+void OcclusionCuller::cullBoxes(const std::vector<uint32_t> &ids, const glm::vec3 *centers, const glm::vec3 *halfExtents,
+	std::vector<uint32_t> &visibleIds)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// Boxes are tested in batches on the workers, each writing its own results
+	const size_t batchSize = 256;
+	size_t batchCount = (ids.size() + batchSize - 1) / batchSize;
+	std::vector<uint8_t> results(ids.size());
+	std::vector<int> outside(batchCount), hidden(batchCount);
+
+	auto testBatch = [&](size_t batch) {
+		size_t end = std::min(ids.size(), (batch + 1) * batchSize);
+		for (size_t i = batch * batchSize; i < end; ++i) {
+			Result result = test(centers[ids[i]], halfExtents[ids[i]]);
+			results[i] = (uint8_t)result;
+			outside[batch] += result == OutsideView;
+			hidden[batch] += result == Occluded;
+		}
+	};
+
+	if (batchCount <= 1) {
+		for (size_t batch = 0; batch < batchCount; ++batch)
+			testBatch(batch);
+	} else {
+		for (size_t batch = 0; batch < batchCount; ++batch)
+			workers.submit([&testBatch, batch]() { testBatch(batch); });
+		workers.waitIdle();
+	}
+
+	for (size_t i = 0; i < ids.size(); ++i) {
+		if (results[i] == Visible)
+			visibleIds.push_back(ids[i]);
+	}
+	for (size_t batch = 0; batch < batchCount; ++batch) {
+		outsideView += outside[batch];
+		occluded += hidden[batch];
+	}
+	tested += (int)ids.size();
+	testMs += millisecondsSince(start);
+}
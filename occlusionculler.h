@@ -0,0 +1,81 @@
+#ifndef _OCCLUSIONCULLER_H_
+#define _OCCLUSIONCULLER_H_
+
+#include "threadpool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Software occlusion culling for axis aligned boxes. A few large boxes near the camera are
+// rasterised on the CPU into a small depth buffer, nearest depth kept, and a hierarchy of
+// per-block farthest depths is built over it. Every other box is then tested against it: a box
+// whose nearest point is behind everything drawn over its screen rectangle is hidden.
+// Rasterisation is split into horizontal bands and testing into batches of boxes, both run on
+// the culler's own workers. Rows of pixels are processed four at a time with SSE where available.
+class OcclusionCuller {
+public:
+	// width and height of the depth buffer, rounded up to whole blocks
+	OcclusionCuller(int width = 256, int height = 128, unsigned int threadCount = 0);
+
+	// Clear the depth buffer for a new view. eye is the camera position in world space.
+	void beginFrame(const glm::mat4 &viewProjection, const glm::vec3 &eye);
+
+	// Queue a box to draw into the depth buffer. Boxes reaching behind the near plane are skipped.
+	void addOccluder(const glm::vec3 &center, const glm::vec3 &halfExtents);
+
+	// Draw the queued occluders and build the hierarchy. Call once, after the last addOccluder().
+	void rasterize();
+
+	// False if the box is outside the view or hidden behind the occluders
+	bool visible(const glm::vec3 &center, const glm::vec3 &halfExtents) const;
+
+	// Appends the ids whose box, centers[id] and halfExtents[id], may be visible, in input order
+	void cullBoxes(const std::vector<uint32_t> &ids, const glm::vec3 *centers, const glm::vec3 *halfExtents,
+		std::vector<uint32_t> &visibleIds);
+
+	int width() const { return bufferWidth; }
+	int height() const { return bufferHeight; }
+	const std::vector<float> &depth() const { return depthBuffer; }
+
+	// Counts for the current frame, and the time spent drawing and testing
+	int occluders = 0;
+	int tested = 0;
+	int outsideView = 0;
+	int occluded = 0;
+	double rasterMs = 0.0;
+	double testMs = 0.0;
+
+private:
+	static const int blockSize = 8;		// Pixels along each side of a hierarchy block
+
+	// Screen-space triangle ready for rasterisation
+	struct Triangle {
+		float x[3];
+		float y[3];
+		float z[3];
+		int minY;
+		int maxY;
+	};
+
+	enum Result { Visible, OutsideView, Occluded };
+
+	Result test(const glm::vec3 &center, const glm::vec3 &halfExtents) const;
+	void rasterizeBand(int firstRow, int endRow);
+	void rasterizeTriangle(const Triangle &triangle, int firstRow, int endRow);
+
+	int bufferWidth;
+	int bufferHeight;
+	int blocksX;
+	int blocksY;
+	std::vector<float> depthBuffer;		// Nearest occluder depth per pixel, 1 where there is none
+	std::vector<float> blockDepth;		// Farthest depth in each block of the buffer
+	std::vector<Triangle> triangles;
+
+	glm::mat4 viewProjection;
+	glm::vec3 eye;
+	ThreadPool workers;
+};
+
+#endif
@@ -0,0 +1,70 @@
+// Builds an AssetPack archive from a list of files.
+//
+//   packassets ../FinalProject/assets.pack ../FinalProject/building.vert ../FinalProject/facade0.dds ...
+//
+// Entries are named by the path exactly as given, which must match the strings the scenes load.
+
+#include "assetpack.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+	if (argc < 3) {
+		std::cerr << "Usage: packassets output.pack file..." << std::endl;
+		return 1;
+	}
+
+	std::vector<std::string> names(argv + 2, argv + argc);
+	std::vector<std::vector<char>> contents;
+	for (const std::string &name : names) {
+		std::ifstream file(name, std::ios::in | std::ios::binary);
+		if (!file.is_open()) {
+			std::cerr << "Asset not found " << name << std::endl;
+			return 1;
+		}
+		contents.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	// Header, then the table, then the names, then the aligned data
+	std::vector<PackEntry> entries(names.size());
+	uint64_t offset = sizeof(PackHeader) + entries.size() * sizeof(PackEntry);
+	for (size_t i = 0; i < names.size(); ++i) {
+		entries[i].nameOffset = (uint32_t)offset;
+		entries[i].nameLength = (uint32_t)names[i].size();
+		offset += names[i].size();
+	}
+	for (size_t i = 0; i < names.size(); ++i) {
+		offset = (offset + packAlignment - 1) / packAlignment * packAlignment;
+		entries[i].offset = offset;
+		entries[i].size = contents[i].size();
+		offset += contents[i].size();
+	}
+
+	std::ofstream pack(argv[1], std::ios::out | std::ios::binary);
+	if (!pack.is_open()) {
+		std::cerr << "Failed to write " << argv[1] << std::endl;
+		return 1;
+	}
+
+	PackHeader header = { packMagic, packVersion, (uint32_t)entries.size(), 0 };
+	pack.write((const char *)&header, sizeof(header));
+	pack.write((const char *)entries.data(), entries.size() * sizeof(PackEntry));
+	for (const std::string &name : names)
+		pack.write(name.data(), name.size());
+
+	const char padding[packAlignment] = {};
+	for (size_t i = 0; i < names.size(); ++i) {
+		pack.write(padding, entries[i].offset - (uint64_t)pack.tellp());
+		pack.write(contents[i].data(), contents[i].size());
+		std::cout << names[i] << ": " << contents[i].size() << " bytes" << std::endl;
+	}
+
+	std::cout << "Wrote " << names.size() << " entries, " << (uint64_t)pack.tellp() << " bytes to " << argv[1] << std::endl;
+	return pack.good() ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+FrameProfiler::FrameProfiler(size_t historyFrames, size_t maxTraceEvents)
+	: origin(Clock::now()), frameHistory(std::max<size_t>(historyFrames, 1), 0.0f), maxEvents(maxTraceEvents)
+{
+}
+
+void FrameProfiler::initialize()
+{
+	initialized = true;
+}
+
+void FrameProfiler::cleanup()
+{
+	for (auto &entry : gpuPasses)
+		glDeleteQueries((GLsizei)entry.second.queries.size(), entry.second.queries.data());
+	gpuPasses.clear();
+	openPass = nullptr;
+	initialized = false;
+}
+
+double FrameProfiler::now() const
+{
+	return std::chrono::duration<double, std::micro>(Clock::now() - origin).count();
+}
+
+void FrameProfiler::addEvent(const char *name, int track, double startUs, double durationUs)
+{
+	// Keep the frame history going but stop growing the trace once it is full
+	if (events.size() < maxEvents)
+		events.push_back({name, track, startUs, durationUs});
+}
+
+void FrameProfiler::beginFrame()
+{
+	collectGpuResults();
+	frameStartUs = now();
+}
+
+void FrameProfiler::endFrame()
+{
+	double endUs = now();
+	addEvent("frame", 0, frameStartUs, endUs - frameStartUs);
+
+	frameHistory[historyCount % frameHistory.size()] = float((endUs - frameStartUs) / 1000.0);
+	historyCount++;
+	frameIndex++;
+}
+
+void FrameProfiler::beginScope(const char *name)
+{
+	openScopes.push_back(std::make_pair(name, now()));
+}
+
+void FrameProfiler::endScope()
+{
+	if (openScopes.empty())
+		return;
+	double endUs = now();
+	addEvent(openScopes.back().first, 0, openScopes.back().second, endUs - openScopes.back().second);
+	openScopes.pop_back();
+}
+
+void FrameProfiler::beginGpuPass(const char *name)
+{
+	if (!initialized || openPass)
+		return;
+
+	GpuPass &pass = gpuPasses[name];
+	if (pass.queries.empty()) {
+		pass.queries.resize(queryRingSize);
+		pass.startUs.resize(queryRingSize, 0.0);
+		pass.pending.resize(queryRingSize, false);
+		glGenQueries(queryRingSize, pass.queries.data());
+	}
+
+	// The slot is from queryRingSize frames ago. If its result is somehow still not
+	// available, skip timing this frame rather than stall on it.
+	int slot = int(frameIndex % queryRingSize);
+	if (pass.pending[slot])
+		return;
+
+	pass.startUs[slot] = now();
+	pass.pending[slot] = true;
+	glBeginQuery(GL_TIME_ELAPSED, pass.queries[slot]);
+	openPass = &pass;
+}
+
+void FrameProfiler::endGpuPass()
+{
+	if (!openPass)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	openPass = nullptr;
+}
+
+void FrameProfiler::collectGpuResults()
+{
+	for (auto &entry : gpuPasses) {
+		GpuPass &pass = entry.second;
+		for (int slot = 0; slot < queryRingSize; ++slot) {
+			if (!pass.pending[slot])
+				continue;
+
+			GLint available = 0;
+			glGetQueryObjectiv(pass.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				continue;
+
+			GLuint64 elapsedNs = 0;
+			glGetQueryObjectui64v(pass.queries[slot], GL_QUERY_RESULT, &elapsedNs);
+			pass.pending[slot] = false;
+			pass.lastMs = float(elapsedNs / 1.0e6);
+
+			// Timer queries carry no start time, so the pass is placed on the GPU track at the
+			// moment the CPU issued it. Durations are exact, positions are approximate.
+			addEvent(entry.first.c_str(), 1, pass.startUs[slot], elapsedNs / 1000.0);
+		}
+	}
+}
+
+float FrameProfiler::percentile(float p) const
+{
+	size_t count = std::min(historyCount, frameHistory.size());
+	if (count == 0)
+		return 0.0f;
+
+	std::vector<float> sorted(frameHistory.begin(), frameHistory.begin() + count);
+	size_t rank = std::min(count - 1, size_t(p / 100.0f * count));
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+	return sorted[rank];
+}
+
+float FrameProfiler::gpuTime(const char *name) const
+{
+	auto it = gpuPasses.find(name);
+	return it == gpuPasses.end() ? 0.0f : it->second.lastMs;
+}
+
+bool FrameProfiler::writeChromeTrace(const char *path) const
+{
+	FILE *file = fopen(path, "w");
+	if (!file) {
+		std::cerr << "Failed to write trace " << path << std::endl;
+		return false;
+	}
+
+	// Complete ("X") events, CPU scopes on thread 1 and GPU passes on thread 2
+	fprintf(file, "{\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+	for (const TraceEvent &event : events) {
+		fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			event.name, event.track ? "gpu" : "cpu", event.track + 1, event.startUs, event.durationUs);
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(file);
+
+	std::cout << "Trace written: " << path << " (" << events.size() << " events)" << std::endl;
+	return true;
+}
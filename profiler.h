@@ -0,0 +1,100 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <glad/gl.h>
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Per-frame CPU and GPU timings.
+// CPU scopes nest and are timed with a steady clock. Each GPU pass owns a small ring of
+// GL_TIME_ELAPSED queries, so a result is only read once the GPU has finished with it,
+// a few frames later, and the render thread never waits on the driver.
+// Frame times go into a rolling history for percentiles, and every scope and pass is kept
+// as a trace event that writeChromeTrace() exports for chrome://tracing or Perfetto.
+class FrameProfiler {
+public:
+	explicit FrameProfiler(size_t historyFrames = 600, size_t maxTraceEvents = 500000);
+
+	// Timer queries need the GL context, create them once it is current
+	void initialize();
+	void cleanup();
+
+	void beginFrame();
+	void endFrame();
+
+	// CPU scopes must be closed in reverse order of opening
+	void beginScope(const char *name);
+	void endScope();
+
+	// GL_TIME_ELAPSED queries cannot nest, so at most one GPU pass may be open at a time
+	void beginGpuPass(const char *name);
+	void endGpuPass();
+
+	// Frame time in milliseconds at percentile p (0-100) over the rolling history
+	float percentile(float p) const;
+
+	// Most recent GPU time of a pass in milliseconds, 0 until the first result arrives
+	float gpuTime(const char *name) const;
+
+	// Write the recorded events in Chrome trace event format
+	bool writeChromeTrace(const char *path) const;
+
+	unsigned long frameCount() const { return frameIndex; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct TraceEvent {
+		const char *name;		// Scope names are string literals and outlive the profiler
+		int track;				// 0 for CPU scopes, 1 for GPU passes
+		double startUs;
+		double durationUs;
+	};
+
+	// Query ring of one GPU pass. Slot i is reused every queryRingSize frames.
+	struct GpuPass {
+		std::vector<GLuint> queries;
+		std::vector<double> startUs;		// CPU time at which each slot was issued
+		std::vector<bool> pending;
+		float lastMs = 0.0f;
+	};
+
+	static const int queryRingSize = 4;
+
+	double now() const;
+	void addEvent(const char *name, int track, double startUs, double durationUs);
+	void collectGpuResults();
+
+	Clock::time_point origin;
+	double frameStartUs = 0.0;
+	unsigned long frameIndex = 0;
+
+	std::vector<std::pair<const char *, double>> openScopes;
+	std::unordered_map<std::string, GpuPass> gpuPasses;
+	GpuPass *openPass = nullptr;
+	bool initialized = false;
+
+	std::vector<float> frameHistory;	// Ring of frame times in milliseconds
+	size_t historyCount = 0;
+
+	std::vector<TraceEvent> events;
+	size_t maxEvents;
+};
+
+// Times the enclosing block as a CPU scope
+class ProfileScope {
+public:
+	ProfileScope(FrameProfiler &profiler, const char *name) : profiler(profiler) { profiler.beginScope(name); }
+	~ProfileScope() { profiler.endScope(); }
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	FrameProfiler &profiler;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#include "scenewindow.h"
+
+#include <iostream>
+
+GLFWwindow *CreateSceneWindow(const char *title, const SceneWindowOptions &options)
+{
+#ifdef GLFW_PLATFORM_NULL
+	if (options.nullPlatform)
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+
+	if (!glfwInit()) {
+		std::cerr << "Failed to initialize GLFW." << std::endl;
+		return NULL;
+	}
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // For MacOS
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, options.visible ? GLFW_TRUE : GLFW_FALSE);
+	if (options.contextApi != 0)
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, options.contextApi);
+
+	GLFWwindow *window = glfwCreateWindow(options.width, options.height, title, NULL, NULL);
+	if (window == NULL) {
+		std::cerr << "Failed to open a GLFW window." << std::endl;
+		glfwTerminate();
+		return NULL;
+	}
+	glfwMakeContextCurrent(window);
+
+	// Load OpenGL functions, gladLoadGL returns the loaded version, 0 on error.
+	if (gladLoadGL(glfwGetProcAddress) == 0) {
+		std::cerr << "Failed to initialize OpenGL context." << std::endl;
+		glfwTerminate();
+		return NULL;
+	}
+
+	if (options.swapInterval >= 0)
+		glfwSwapInterval(options.swapInterval);
+
+	// Ensure we can capture the escape key being pressed
+	glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
+	if (options.captureCursor)
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+	return window;
+}
@@ -0,0 +1,22 @@
+#ifndef _SCENEWINDOW_H_
+#define _SCENEWINDOW_H_
+
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+
+// How a scene's window and OpenGL context are created
+struct SceneWindowOptions {
+	int width = 1024;
+	int height = 768;
+	bool visible = true;
+	bool captureCursor = false;		// Hide the cursor and report unbounded motion, for mouse look
+	bool nullPlatform = false;		// Use GLFW's null platform, so no display is needed
+	int contextApi = 0;				// A GLFW_*_CONTEXT_API value, 0 for the platform default
+	int swapInterval = -1;			// -1 leaves the driver default
+};
+
+// Initialise GLFW, open a window with an OpenGL 3.3 core context, make it current and load
+// the GL functions. On failure the error is reported, GLFW is terminated and NULL returned.
+GLFWwindow *CreateSceneWindow(const char *title, const SceneWindowOptions &options = SceneWindowOptions());
+
+#endif
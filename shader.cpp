@@ -1,4 +1,5 @@
 #include "shader.h"
+#include "assetpack.h"
 
 #include <string> 
 #include <iostream> 
@@ -6,39 +7,125 @@
 #include <sstream> 
 #include <vector>
 
+// Packed shaders are passed to GL as pointer and length into the mapping, loose files are read into storage
+static bool ReadShaderSource(const char *file_path, std::string &storage, const char **source, GLint *length)
+{
+	const unsigned char *data;
+	size_t size;
+	if (DefaultAssetPack().find(file_path, &data, &size))
+	{
+		*source = (const char *)data;
+		*length = (GLint)size;
+		return true;
+	}
+
+	std::ifstream ShaderStream(file_path, std::ios::in);
+	if (!ShaderStream.is_open())
+		return false;
+
+	std::stringstream sstr;
+	sstr << ShaderStream.rdbuf();
+	storage = sstr.str();
+	ShaderStream.close();
+
+	*source = storage.c_str();
+	*length = (GLint)storage.size();
+	return true;
+}
+
+// Nested includes deeper than this are taken to be a cycle
+static const int maxIncludeDepth = 8;
+
+// GLSL 3.30 has no includes, so lines of the form #include "name" are replaced here by the named
+// file, looked up next to the including one. #line directives keep compile errors in the
+// including file on the right line numbers.
+static bool ExpandIncludes(const char *file_path, const std::string &source, std::string &expanded, int depth)
+{
+	std::string directory = file_path;
+	size_t slash = directory.find_last_of("/\\");
+	directory = slash == std::string::npos ? "" : directory.substr(0, slash + 1);
+
+	std::istringstream lines(source);
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(lines, line))
+	{
+		lineNumber++;
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+		{
+			expanded += line;
+			expanded += '\n';
+			continue;
+		}
+
+		size_t open = line.find('"', start);
+		size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+		if (close == std::string::npos)
+		{
+			printf("Malformed #include in %s line %d\n", file_path, lineNumber);
+			return false;
+		}
+		std::string include_path = directory + line.substr(open + 1, close - open - 1);
+		if (depth >= maxIncludeDepth)
+		{
+			printf("Shader includes nested too deeply at %s\n", include_path.c_str());
+			return false;
+		}
+
+		std::string storage;
+		const char *includeSource;
+		GLint includeLength;
+		if (!ReadShaderSource(include_path.c_str(), storage, &includeSource, &includeLength))
+		{
+			printf("Shader include not found %s\n", include_path.c_str());
+			return false;
+		}
+		expanded += "#line 1\n";
+		if (!ExpandIncludes(include_path.c_str(), std::string(includeSource, includeLength), expanded, depth + 1))
+			return false;
+		expanded += "#line " + std::to_string(lineNumber + 1) + "\n";
+	}
+	return true;
+}
+
+// Read a shader and splice in its includes. Sources without any still go to GL straight from the pack.
+static bool ReadShaderWithIncludes(const char *file_path, std::string &storage, const char **source, GLint *length)
+{
+	if (!ReadShaderSource(file_path, storage, source, length))
+		return false;
+	if (std::string(*source, *length).find("#include") == std::string::npos)
+		return true;
+
+	std::string expanded;
+	if (!ExpandIncludes(file_path, std::string(*source, *length), expanded, 0))
+		return false;
+	storage = std::move(expanded);
+	*source = storage.c_str();
+	*length = (GLint)storage.size();
+	return true;
+}
+
 GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path)
 {
 	// Create the shaders
 	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
 	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
 
-	// Read the Vertex Shader code from the file
+	// Read the shader code, straight from the mounted asset pack when it holds the file
 	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if (VertexShaderStream.is_open())
-	{
-		std::stringstream sstr;
-		sstr << VertexShaderStream.rdbuf();
-		VertexShaderCode = sstr.str();
-		VertexShaderStream.close();
-	}
-	else
+	const char *VertexSourcePointer;
+	GLint VertexSourceLength;
+	if (!ReadShaderWithIncludes(vertex_file_path, VertexShaderCode, &VertexSourcePointer, &VertexSourceLength))
 	{
 		printf("Vertex shader not found %s.\n", vertex_file_path);
 		return 0;
 	}
 
-	// Read the Fragment Shader code from the file
 	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if (FragmentShaderStream.is_open())
-	{
-		std::stringstream sstr;
-		sstr << FragmentShaderStream.rdbuf();
-		FragmentShaderCode = sstr.str();
-		FragmentShaderStream.close();
-	}
-	else
+	const char *FragmentSourcePointer;
+	GLint FragmentSourceLength;
+	if (!ReadShaderWithIncludes(fragment_file_path, FragmentShaderCode, &FragmentSourcePointer, &FragmentSourceLength))
 	{
 		printf("Fragment shader not found %s.\n", fragment_file_path);
 		return 0;
@@ -49,8 +136,7 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 
 	// Compile Vertex Shader
 	printf("Compiling vertex shader : %s\n", vertex_file_path);
-	char const *VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer, NULL);
+	glShaderSource(VertexShaderID, 1, &VertexSourcePointer, &VertexSourceLength);
 	glCompileShader(VertexShaderID);
 
 	// Check Vertex Shader
@@ -68,8 +154,7 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 
 	// Compile Fragment Shader
 	printf("Compiling fragment shader : %s\n", fragment_file_path);
-	char const *FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer, NULL);
+	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer, &FragmentSourceLength);
 	glCompileShader(FragmentShaderID);
 
 	// Check Fragment Shader
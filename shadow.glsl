@@ -0,0 +1,26 @@
+// Sun shadows, see ShadowCascades. Included by the lit fragment shaders.
+layout(std140) uniform ShadowData {
+    mat4 shadowMatrices[3];
+    vec4 texelSizes;        // World size of a shadow texel in each cascade
+    vec4 towardsLight;      // Unit direction to the sun
+};
+uniform sampler2DArrayShadow shadowMap;
+
+// Fraction of the sun reaching a point, from the first cascade that covers it. The point is
+// pushed out along the normal by a texel or so against acne. Always 9 filtered taps.
+float sunVisibility(vec3 position, vec3 normal)
+{
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    for (int cascade = 0; cascade < 3; ++cascade) {
+        vec3 coord = (shadowMatrices[cascade] * vec4(position + normal * texelSizes[cascade] * 1.5, 1.0)).xyz;
+        if (any(lessThan(coord, vec3(texel * 2.0, 0.0))) || any(greaterThan(coord, vec3(1.0 - texel * 2.0, 1.0))))
+            continue;
+
+        float lit = 0.0;
+        for (int y = -1; y <= 1; ++y)
+            for (int x = -1; x <= 1; ++x)
+                lit += texture(shadowMap, vec4(coord.xy + vec2(x, y) * texel, float(cascade), coord.z));
+        return lit / 9.0;
+    }
+    return 1.0;
+}
@@ -0,0 +1,143 @@
+#include "shadowcascades.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <iostream>
+
+ShadowCascades::ShadowCascades(int resolution, int snapTexels)
+	: size(resolution), snapTexels(snapTexels), lightDirection(0.0f, 1.0f, 0.0f), lightView(1.0f)
+{
+}
+
+void ShadowCascades::initialize()
+{
+	depthArray = GLTexture::create();
+	glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray.get());
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, cascadeCount, 0,
+		GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+	// Linear filtering with comparison gives each lookup a 2x2 PCF for free
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	framebuffer = GLFramebuffer::create();
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray.get(), 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "Shadow cascade framebuffer is incomplete" << std::endl;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowCascades::cleanup()
+{
+	framebuffer.reset();
+	depthArray.reset();
+}
+
+void ShadowCascades::configure(const glm::vec3 &towardsLight, float farDistance, float nearDistance)
+{
+	lightDirection = glm::normalize(towardsLight);
+	glm::vec3 up = std::fabs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	lightView = glm::lookAt(glm::vec3(0.0f), -lightDirection, up);
+
+	for (int i = 0; i < cascadeCount; ++i) {
+		float t = (float)(i + 1) / cascadeCount;
+		float uniform = nearDistance + (farDistance - nearDistance) * t;
+		float logarithmic = nearDistance * std::pow(farDistance / nearDistance, t);
+
+		Cascade &cascade = cascades[i];
+		cascade.radius = 0.5f * (uniform + logarithmic);
+		cascade.snapStep = 2.0f * cascade.radius / size * snapTexels;
+		cascade.halfSize = cascade.radius + cascade.snapStep;
+		cascade.stale = true;
+		cascade.drawn = false;
+	}
+}
+
+void ShadowCascades::update(const glm::vec3 &eye)
+{
+	glm::vec3 center = glm::vec3(lightView * glm::vec4(eye, 1.0f));
+
+	for (Cascade &cascade : cascades) {
+		// The texel grid is fixed in light space, so moving by whole steps leaves every texel where it was
+		glm::vec3 snapped = glm::floor(center / cascade.snapStep + 0.5f) * cascade.snapStep;
+		if (cascade.drawn && snapped == cascade.snappedCenter && !cascade.stale)
+			continue;
+
+		cascade.snappedCenter = snapped;
+		cascade.stale = true;
+
+		// View space looks down -z, towards the light is +z: near covers casters up to casterReach beyond the square
+		float h = cascade.halfSize;
+		glm::mat4 projection = glm::ortho(snapped.x - h, snapped.x + h, snapped.y - h, snapped.y + h,
+			-(snapped.z + h + casterReach), -(snapped.z - h));
+		cascade.pendingMatrix = projection * lightView;
+	}
+}
+
+void ShadowCascades::invalidate(const glm::vec3 &center, const glm::vec3 &halfExtents)
+{
+	glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+	float extent = glm::length(halfExtents);
+
+	for (Cascade &cascade : cascades) {
+		if (!cascade.drawn)
+			continue;
+		glm::vec3 offset = lightCenter - cascade.snappedCenter;
+		float reach = cascade.halfSize + extent;
+		if (std::fabs(offset.x) < reach && std::fabs(offset.y) < reach && offset.z > -reach && offset.z < reach + casterReach)
+			cascade.stale = true;
+	}
+}
+
+void ShadowCascades::beginCascade(int cascade)
+{
+	activeCascade = cascade;
+	glGetIntegerv(GL_VIEWPORT, savedViewport);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.get());
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray.get(), 0, cascade);
+	glViewport(0, 0, size, size);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	// Slope scaled bias against acne on walls facing away from the light
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1.5f, 4.0f);
+}
+
+void ShadowCascades::endCascade()
+{
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+
+	Cascade &cascade = cascades[activeCascade];
+	cascade.renderedMatrix = cascade.pendingMatrix;
+	cascade.stale = false;
+	cascade.drawn = true;
+	renders[activeCascade]++;
+	activeCascade = -1;
+}
+
+ShadowCascades::Uniforms ShadowCascades::uniforms() const
+{
+	// Clip space -1..1 to texture space 0..1
+	glm::mat4 bias = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
+
+	Uniforms result;
+	for (int i = 0; i < cascadeCount; ++i) {
+		result.shadowMatrices[i] = bias * cascades[i].renderedMatrix;
+		result.texelSizes[i] = 2.0f * cascades[i].halfSize / size;
+	}
+	result.texelSizes[3] = 0.0f;
+	result.towardsLight = glm::vec4(lightDirection, 0.0f);
+	return result;
+}
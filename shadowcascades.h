@@ -0,0 +1,85 @@
+#ifndef _SHADOWCASCADES_H_
+#define _SHADOWCASCADES_H_
+
+#include "glresource.h"
+
+#include <glm/glm.hpp>
+
+// Cascaded shadow maps for a directional light, kept as layers of one depth array texture.
+// Every cascade is a square around the camera, orthographic along the light, covering a sphere
+// of its split distance, so turning the camera never changes it. Its position is snapped to a
+// whole number of snap steps in light space, and a cascade is only redrawn when that snapped
+// position moves or casters inside it change. Far cascades therefore stay cached for long
+// stretches, and a redraw never makes the shadow edges shimmer.
+class ShadowCascades {
+public:
+	static const int cascadeCount = 3;
+
+	// Receiver uniforms, laid out as the std140 ShadowData block of the lit fragment shaders
+	struct Uniforms {
+		glm::mat4 shadowMatrices[cascadeCount];	// World space to shadow map coordinates, 0 to 1
+		glm::vec4 texelSizes;					// World size of a texel in each cascade
+		glm::vec4 towardsLight;					// Unit direction to the light, w unused
+	};
+
+	// resolution texels along each side of every cascade, positions snapped to snapTexels of them
+	explicit ShadowCascades(int resolution = 1024, int snapTexels = 8);
+
+	// Needs the GL context
+	void initialize();
+	void cleanup();
+
+	// Light direction, and the distance from the camera the last cascade reaches. Splits follow
+	// the practical scheme, halfway between uniform and logarithmic, from nearDistance.
+	void configure(const glm::vec3 &towardsLight, float farDistance, float nearDistance = 1.0f);
+
+	// Fit the cascades around the eye. Cascades whose snapped position moved become stale.
+	void update(const glm::vec3 &eye);
+
+	// Casters changed in this world space box, stale every cascade that covers it
+	void invalidate(const glm::vec3 &center, const glm::vec3 &halfExtents);
+
+	bool stale(int cascade) const { return cascades[cascade].stale; }
+
+	// Make the cascade's layer the depth target and clear it. Draw its casters, depth only,
+	// with lightViewProjection(cascade), then call endCascade().
+	void beginCascade(int cascade);
+	void endCascade();
+
+	const glm::mat4 &lightViewProjection(int cascade) const { return cascades[cascade].pendingMatrix; }
+
+	// Matrices of the cascades as last drawn, for the receivers
+	Uniforms uniforms() const;
+
+	GLuint texture() const { return depthArray.get(); }
+	float split(int cascade) const { return cascades[cascade].radius; }
+
+	// Times each cascade has been drawn
+	unsigned long renders[cascadeCount] = {};
+
+private:
+	struct Cascade {
+		float radius = 0.0f;			// Split distance from the eye
+		float halfSize = 0.0f;			// Half the side of the square, the radius plus a snap step
+		float snapStep = 0.0f;
+		glm::vec3 snappedCenter;		// Light space, z included
+		glm::mat4 pendingMatrix = glm::mat4(0.0f);	// For the next draw
+		glm::mat4 renderedMatrix = glm::mat4(0.0f);	// The layer's contents were drawn with this, zero maps nothing into it
+		bool stale = true;
+		bool drawn = false;
+	};
+
+	int size;
+	int snapTexels;
+	float casterReach = 60.0f;			// Casters this far towards the light outside a cascade still land in it
+	glm::vec3 lightDirection;
+	glm::mat4 lightView;				// Rotation only, z towards the light
+	Cascade cascades[cascadeCount];
+
+	GLTexture depthArray;
+	GLFramebuffer framebuffer;
+	int activeCascade = -1;
+	GLint savedViewport[4];
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "simulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+CameraState InterpolateCamera(const CameraState &a, const CameraState &b, float alpha)
+{
+	CameraState state;
+	state.position = glm::mix(a.position, b.position, alpha);
+	state.yaw = a.yaw + (b.yaw - a.yaw) * alpha;
+	state.pitch = a.pitch + (b.pitch - a.pitch) * alpha;
+	return state;
+}
+
+glm::vec3 CameraFront(float yaw, float pitch)
+{
+	glm::vec3 front;
+	front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+	front.y = sin(glm::radians(pitch));
+	front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+	return glm::normalize(front);
+}
+
+SimulationLoop::SimulationLoop(double tickSeconds, TickFunction tick, const CameraState &initial)
+	: tickLength(tickSeconds), tick(tick), previous(initial), current(initial), currentTime(Clock::now())
+{
+}
+
+SimulationLoop::~SimulationLoop()
+{
+	stop();
+}
+
+void SimulationLoop::runTick()
+{
+	// The tick itself runs unlocked, only publishing its result takes the lock
+	CameraState next = tick(tickLength);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	previous = current;
+	current = next;
+	currentTime = Clock::now();
+	ticks++;
+}
+
+void SimulationLoop::advance(double frameSeconds)
+{
+	accumulator += frameSeconds;
+
+	int owed = int(accumulator / tickLength);
+	if (owed > maxCatchUpTicks) {
+		// After a long stall, e.g. a breakpoint or window drag, skip ahead instead of spiralling
+		dropped += owed - maxCatchUpTicks;
+		accumulator -= (owed - maxCatchUpTicks) * tickLength;
+	}
+
+	while (accumulator >= tickLength) {
+		runTick();
+		accumulator -= tickLength;
+	}
+}
+
+void SimulationLoop::startThread()
+{
+	if (worker.joinable())
+		return;
+	running = true;
+	worker = std::thread(&SimulationLoop::threadLoop, this);
+}
+
+void SimulationLoop::stop()
+{
+	running = false;
+	if (worker.joinable())
+		worker.join();
+}
+
+void SimulationLoop::threadLoop()
+{
+	Clock::duration step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(tickLength));
+	Clock::time_point next = Clock::now();
+
+	while (running) {
+		runTick();
+		next += step;
+
+		Clock::time_point now = Clock::now();
+		if (now - next > step * (int)maxCatchUpTicks) {
+			dropped += (unsigned long)((now - next) / step);
+			next = now;
+		}
+		std::this_thread::sleep_until(next);
+	}
+}
+
+CameraState SimulationLoop::renderState()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Same thread: the leftover time is how far the present lies past the current tick.
+	// Simulation thread: measure it against the time the current tick was published.
+	double since = worker.joinable()
+		? std::chrono::duration<double>(Clock::now() - currentTime).count()
+		: accumulator;
+	float alpha = (float)std::min(1.0, std::max(0.0, since / tickLength));
+	return InterpolateCamera(previous, current, alpha);
+}
@@ -0,0 +1,83 @@
+#ifndef _SIMULATION_H_
+#define _SIMULATION_H_
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Camera pose produced by a simulation tick
+struct CameraState {
+	glm::vec3 position;
+	float yaw;
+	float pitch;
+};
+
+CameraState InterpolateCamera(const CameraState &a, const CameraState &b, float alpha);
+
+// Unit view direction for a yaw and pitch in degrees
+glm::vec3 CameraFront(float yaw, float pitch);
+
+// Runs the simulation at a fixed rate, independent of how fast frames are drawn.
+// The tick function advances the world by one step of tickSeconds and returns the
+// new camera. Rendering draws a blend of the last two ticks, so motion stays smooth
+// when the frame rate and tick rate differ.
+//
+// Ticks either run on the render thread, as many per frame as elapsed time calls
+// for (advance), or on a thread of their own paced by the steady clock (startThread).
+class SimulationLoop {
+public:
+	typedef std::function<CameraState(double tickSeconds)> TickFunction;
+
+	SimulationLoop(double tickSeconds, TickFunction tick, const CameraState &initial);
+	~SimulationLoop();
+
+	SimulationLoop(const SimulationLoop&) = delete;
+	SimulationLoop& operator=(const SimulationLoop&) = delete;
+
+	// Same thread: run the ticks owed for frameSeconds of elapsed time
+	void advance(double frameSeconds);
+
+	// Simulation thread: ticks keep running until stop()
+	void startThread();
+	void stop();
+	bool threaded() const { return worker.joinable(); }
+
+	// Camera to draw this frame
+	CameraState renderState();
+
+	double tickSeconds() const { return tickLength; }
+	unsigned long tickCount() const { return ticks; }
+
+	// Ticks dropped because the simulation fell more than maxCatchUpTicks behind
+	unsigned long droppedTicks() const { return dropped; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// A frame that took longer than this many ticks does not make the simulation catch up in full
+	static const int maxCatchUpTicks = 8;
+
+	void runTick();
+	void threadLoop();
+
+	double tickLength;
+	TickFunction tick;
+
+	std::mutex mutex;			// Guards the states below when ticking on the simulation thread
+	CameraState previous;
+	CameraState current;
+	Clock::time_point currentTime;	// When the current state was produced
+
+	double accumulator = 0.0;
+	std::atomic<unsigned long> ticks{0};
+	std::atomic<unsigned long> dropped{0};
+
+	std::thread worker;
+	std::atomic<bool> running{false};
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include "skybox.h"
+#include "shader.h"
+#include "assetpack.h"
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Canonical box, four corners per face: front, back, left, right, top, bottom
+static const GLfloat skyboxVertices[72] = {
+	-1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f,
+	1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f,
+	-1.0f, -1.0f, -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, -1.0f,
+	1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
+	-1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f,
+	-1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f,
+};
+
+// Reversed winding, so the inner faces are the front faces seen from inside the box
+static const GLuint skyboxIndices[36] = {
+	0, 3, 2, 0, 2, 1,
+	4, 7, 6, 4, 6, 5,
+	8, 11, 10, 8, 10, 9,
+	12, 15, 14, 12, 14, 13,
+	16, 19, 18, 16, 18, 17,
+	20, 23, 22, 20, 22, 21,
+};
+
+// Where each face's corners sit in the cross layout image, in the vertex order above
+static const GLfloat crossUVs[48] = {
+	0.5f, 0.666f, 0.25f, 0.666f, 0.25f, 0.333f, 0.5f, 0.333f,		// Pos Z
+	1.0f, 0.666f, 0.75f, 0.666f, 0.75f, 0.333f, 1.0f, 0.333f,		// Neg Z
+	0.75f, 0.666f, 0.5f, 0.666f, 0.5f, 0.333f, 0.75f, 0.333f,		// Pos X
+	0.25f, 0.666f, 0.0f, 0.666f, 0.0f, 0.333f, 0.25f, 0.333f,		// Neg X
+	0.5f, 0.333f, 0.25f, 0.333f, 0.25f, 0.0f, 0.5f, 0.0f,			// Neg Y
+	0.5f, 1.0f, 0.25f, 1.0f, 0.25f, 0.666f, 0.5f, 0.666f,			// Pos Y
+};
+
+void Skybox::initialize(const char *vertex_file_path, const char *fragment_file_path, const char *cross_texture_path)
+{
+	vertexArray = GLVertexArray::create();
+	glBindVertexArray(vertexArray.get());
+
+	vertexBuffer = GLBuffer::create();
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.get());
+	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), skyboxVertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+	indexBuffer = GLBuffer::create();
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.get());
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(skyboxIndices), skyboxIndices, GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+
+	program = GLProgram(LoadShadersFromFile(vertex_file_path, fragment_file_path));
+	if (!program)
+		std::cerr << "Failed to load skybox shaders." << std::endl;
+
+	vpMatrixID = glGetUniformLocation(program.get(), "VP");
+	skyboxSamplerID = glGetUniformLocation(program.get(), "skyboxSampler");
+	cubemap = buildCubemap(cross_texture_path);
+
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+	samplesQuery = GLQuery::create();
+}
+
+void Skybox::cleanup()
+{
+	vertexBuffer.reset();
+	indexBuffer.reset();
+	vertexArray.reset();
+	cubemap.reset();
+	samplesQuery.reset();
+	program.reset();
+}
+
+// Every cube map texel looks up the point of the cross layout box it would have seen, so the
+// sky looks the same as the image drawn on a textured box
+GLTexture Skybox::buildCubemap(const char *texture_file_path)
+{
+	int w, h, channels;
+	const unsigned char *packed;
+	size_t packedSize;
+	unsigned char *img = DefaultAssetPack().find(texture_file_path, &packed, &packedSize)
+		? stbi_load_from_memory(packed, (int)packedSize, &w, &h, &channels, 3)
+		: stbi_load(texture_file_path, &w, &h, &channels, 3);
+
+	GLTexture texture = GLTexture::create();
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture.get());
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	if (!img) {
+		std::cout << "Failed to load texture " << texture_file_path << std::endl;
+		return texture;
+	}
+
+	int faceSize = w / 4;
+	std::vector<unsigned char> face((size_t)faceSize * faceSize * 3);
+	for (int f = 0; f < 6; ++f) {
+		for (int j = 0; j < faceSize; ++j) {
+			for (int i = 0; i < faceSize; ++i) {
+				// Direction through texel (i, j) of face f, following the GL cube map face orientation
+				float sc = 2.0f * (i + 0.5f) / faceSize - 1.0f;
+				float tc = 2.0f * (j + 0.5f) / faceSize - 1.0f;
+				glm::vec3 d;
+				switch (f) {
+					case 0: d = glm::vec3(1.0f, -tc, -sc); break;	// +X
+					case 1: d = glm::vec3(-1.0f, -tc, sc); break;	// -X
+					case 2: d = glm::vec3(sc, 1.0f, tc); break;		// +Y
+					case 3: d = glm::vec3(sc, -1.0f, -tc); break;	// -Y
+					case 4: d = glm::vec3(sc, -tc, 1.0f); break;	// +Z
+					default: d = glm::vec3(-sc, -tc, -1.0f); break;	// -Z
+				}
+
+				// Box face hit by the direction, in the vertex data order: front, back, left, right, top, bottom
+				int boxFace;
+				if (std::fabs(d.z) >= std::fabs(d.x) && std::fabs(d.z) >= std::fabs(d.y))
+					boxFace = d.z > 0.0f ? 0 : 1;
+				else if (std::fabs(d.x) >= std::fabs(d.y))
+					boxFace = d.x < 0.0f ? 2 : 3;
+				else
+					boxFace = d.y > 0.0f ? 4 : 5;
+
+				// Interpolate that face's UVs at the hit point
+				const GLfloat *p = &skyboxVertices[boxFace * 12];
+				const GLfloat *t = &crossUVs[boxFace * 8];
+				glm::vec3 p0(p[0], p[1], p[2]), e1 = glm::vec3(p[3], p[4], p[5]) - p0, e2 = glm::vec3(p[9], p[10], p[11]) - p0;
+				glm::vec3 hit = d / std::max(std::fabs(d.x), std::max(std::fabs(d.y), std::fabs(d.z)));
+				float a = glm::dot(hit - p0, e1) / glm::dot(e1, e1);
+				float b = glm::dot(hit - p0, e2) / glm::dot(e2, e2);
+				float u = t[0] + a * (t[2] - t[0]) + b * (t[6] - t[0]);
+				float v = t[1] + a * (t[3] - t[1]) + b * (t[7] - t[1]);
+
+				int x = std::min(std::max((int)(u * w), 0), w - 1);
+				int y = std::min(std::max((int)(v * h), 0), h - 1);
+				memcpy(&face[((size_t)j * faceSize + i) * 3], &img[((size_t)y * w + x) * 3], 3);
+			}
+		}
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, GL_RGB, faceSize, faceSize, 0, GL_RGB, GL_UNSIGNED_BYTE, face.data());
+	}
+	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	std::cout << "Texture loaded: " << texture_file_path << " (cube map)" << std::endl;
+
+	stbi_image_free(img);
+	return texture;
+}
+
+void Skybox::render(const glm::mat4 &projection, const glm::mat4 &view, bool depthTest)
+{
+	// Pick up an earlier frame's fragment count without waiting for the GPU
+	if (samplesQueryPending) {
+		GLuint available = 0;
+		glGetQueryObjectuiv(samplesQuery.get(), GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			glGetQueryObjectuiv(samplesQuery.get(), GL_QUERY_RESULT, &visibleSamples);
+			samplesQueryPending = false;
+		}
+	}
+
+	glUseProgram(program.get());
+	glBindVertexArray(vertexArray.get());
+
+	if (!depthTest)
+		glDisable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_FALSE);
+
+	// Without the translation the sky stays centred on the camera
+	glm::mat4 vp = projection * glm::mat4(glm::mat3(view));
+	glUniformMatrix4fv(vpMatrixID, 1, GL_FALSE, &vp[0][0]);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap.get());
+	glUniform1i(skyboxSamplerID, 0);
+
+	if (!samplesQueryPending)
+		glBeginQuery(GL_SAMPLES_PASSED, samplesQuery.get());
+
+	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (void*)0);
+
+	if (!samplesQueryPending) {
+		glEndQuery(GL_SAMPLES_PASSED);
+		samplesQueryPending = true;
+	}
+
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+	glEnable(GL_DEPTH_TEST);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,40 @@
+#ifndef _SKYBOX_H_
+#define _SKYBOX_H_
+
+#include "glresource.h"
+
+#include <glm/glm.hpp>
+
+// Sky drawn from a cube map centred on the camera. The cube map is resampled once from an image
+// in the horizontal cross layout, four faces wide and three high. The shaders, skybox.vert and
+// skybox.frag, pin the box to the far plane, so drawn after the opaque geometry with GL_LEQUAL,
+// early depth testing drops every pixel something else already covers.
+class Skybox {
+public:
+	// Needs the GL context
+	void initialize(const char *vertex_file_path, const char *fragment_file_path, const char *cross_texture_path);
+	void cleanup();
+
+	// Only the rotation of view reaches the shader. Without depthTest every pixel is shaded, as
+	// when the sky was drawn before the scene.
+	void render(const glm::mat4 &projection, const glm::mat4 &view, bool depthTest = true);
+
+	GLuint visibleSamples = 0;		// Sky fragments that passed the depth test in a recent frame
+
+private:
+	GLTexture buildCubemap(const char *texture_file_path);
+
+	GLProgram program;
+	GLVertexArray vertexArray;
+	GLBuffer vertexBuffer;
+	GLBuffer indexBuffer;
+	GLTexture cubemap;
+	GLint vpMatrixID = -1;
+	GLint skyboxSamplerID = -1;
+
+	// Counts the sky fragments, read back a frame or more later without waiting
+	GLQuery samplesQuery;
+	bool samplesQueryPending = false;
+};
+
+#endif
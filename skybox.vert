@@ -1,15 +1,15 @@
 #version 330 core
 
 layout(location = 0) in vec3 vertexPosition; // Position of each vertex
-layout(location = 1) in vec3 vertexColor;
-layout(location = 2) in vec2 vertexUV; // TODO: To add UV to this vertex shader 
 
-uniform mat4 MVP; // Model-View-Projection matrix
+uniform mat4 VP; // Projection times the rotation-only view matrix
 
-out vec2 UV; // Pass UV coordinates to fragment shader
+out vec3 direction; // Cube map lookup direction
 
 void main() {
-    gl_Position = MVP * vec4(vertexPosition, 1.0);
-    UV = vertexUV;
-}
+    direction = vertexPosition;
 
+    // z = w puts every sky fragment exactly on the far plane
+    vec4 position = VP * vec4(vertexPosition, 1.0);
+    gl_Position = position.xyww;
+}
@@ -0,0 +1,88 @@
+#include "spatialgrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+int SpatialGrid::cellOf(float coordinate) const
+{
+	// Cells are centred on multiples of cellSize, like the scene's tiles
+	return (int)std::floor(coordinate / cellSize + 0.5f);
+}
+
+void SpatialGrid::insert(uint32_t id, const glm::vec3 &center, const glm::vec3 &halfExtents)
+{
+	int minX = cellOf(center.x - halfExtents.x), maxX = cellOf(center.x + halfExtents.x);
+	int minZ = cellOf(center.z - halfExtents.z), maxZ = cellOf(center.z + halfExtents.z);
+
+	for (int x = minX; x <= maxX; ++x)
+		for (int z = minZ; z <= maxZ; ++z)
+			cells[key(x, z)].push_back(id);
+}
+
+void SpatialGrid::query(const glm::vec2 &minXZ, const glm::vec2 &maxXZ, std::vector<uint32_t> &ids) const
+{
+	ids.clear();
+	int minX = cellOf(minXZ.x), maxX = cellOf(maxXZ.x);
+	int minZ = cellOf(minXZ.y), maxZ = cellOf(maxXZ.y);
+
+	for (int x = minX; x <= maxX; ++x) {
+		for (int z = minZ; z <= maxZ; ++z) {
+			auto cell = cells.find(key(x, z));
+			if (cell != cells.end())
+				ids.insert(ids.end(), cell->second.begin(), cell->second.end());
+		}
+	}
+
+	// Boxes spanning several cells are listed in each of them
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+bool SweepSphereBox(const glm::vec3 &start, const glm::vec3 &end, float radius,
+	const glm::vec3 &center, const glm::vec3 &halfExtents, float &hitFraction, glm::vec3 &hitNormal)
+{
+	// Grow the box by the radius and trace the centre of the sphere through it as a segment.
+	// The grown box has square corners where the true shape is rounded, erring on the side of a hit.
+	glm::vec3 lo = center - halfExtents - glm::vec3(radius);
+	glm::vec3 hi = center + halfExtents + glm::vec3(radius);
+	glm::vec3 motion = end - start;
+
+	float enter = 0.0f, exit = 1.0f;
+	int enterAxis = -1;
+	float enterSign = 0.0f;
+	for (int axis = 0; axis < 3; ++axis) {
+		if (std::fabs(motion[axis]) < 1e-8f) {
+			if (start[axis] <= lo[axis] || start[axis] >= hi[axis])
+				return false;
+			continue;
+		}
+
+		float inverse = 1.0f / motion[axis];
+		float near = (lo[axis] - start[axis]) * inverse;
+		float far = (hi[axis] - start[axis]) * inverse;
+		float sign = -1.0f;		// Moving along +axis enters through the low face
+		if (near > far) {
+			std::swap(near, far);
+			sign = 1.0f;
+		}
+
+		if (near > enter || enterAxis < 0) {
+			if (near > enter)
+				enter = near;
+			enterAxis = axis;
+			enterSign = sign;
+		}
+		exit = std::min(exit, far);
+		if (enter > exit || far <= 0.0f)
+			return false;
+	}
+
+	// Started inside the grown box on every moving axis: let the sphere move out
+	if (enterAxis < 0 || enter <= 0.0f)
+		return false;
+
+	hitFraction = enter;
+	hitNormal = glm::vec3(0.0f);
+	hitNormal[enterAxis] = enterSign;
+	return true;
+}
@@ -0,0 +1,38 @@
+#ifndef _SPATIALGRID_H_
+#define _SPATIALGRID_H_
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid over the xz plane that buckets boxes by the cells they overlap.
+// Queries only visit the cells under the query rectangle, so their cost depends
+// on the size of the query, not on how many boxes the grid holds.
+class SpatialGrid {
+public:
+	explicit SpatialGrid(float cellSize) : cellSize(cellSize) {}
+
+	void insert(uint32_t id, const glm::vec3 &center, const glm::vec3 &halfExtents);
+
+	// Ids of the boxes in the cells overlapping [minXZ, maxXZ], each id once
+	void query(const glm::vec2 &minXZ, const glm::vec2 &maxXZ, std::vector<uint32_t> &ids) const;
+
+	size_t cellCount() const { return cells.size(); }
+
+private:
+	int cellOf(float coordinate) const;
+	static uint64_t key(int x, int z) { return (uint64_t(uint32_t(x)) << 32) | uint32_t(z); }
+
+	float cellSize;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+};
+
+// Sweep a sphere from start to end against an axis aligned box. On a hit, returns the
+// fraction of the motion travelled before contact and the normal of the face touched.
+// A sphere that starts inside the box is not stopped, so it can always move out.
+bool SweepSphereBox(const glm::vec3 &start, const glm::vec3 &end, float radius,
+	const glm::vec3 &center, const glm::vec3 &halfExtents, float &hitFraction, glm::vec3 &hitNormal);
+
+#endif
@@ -0,0 +1,154 @@
+#include "streambuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void (APIENTRY *BufferStorageProc)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+static bool HasExtension(const char *name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && strcmp(extension, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+static bool Signalled(GLsync fence)
+{
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+StreamBuffer::StreamBuffer(size_t bytesPerFrame, int framesInFlight)
+	: regionSize(bytesPerFrame), regionCount(std::min(std::max(framesInFlight, 1), 8))
+{
+}
+
+void StreamBuffer::initialize(GLADloadfunc load)
+{
+	size_t total = regionSize * regionCount;
+	storage = GLBuffer::create();
+	glBindBuffer(GL_COPY_WRITE_BUFFER, storage.get());
+
+	BufferStorageProc bufferStorage = NULL;
+	if (load && HasExtension("GL_ARB_buffer_storage"))
+		bufferStorage = (BufferStorageProc)load("glBufferStorage");
+
+	if (bufferStorage) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		bufferStorage(GL_COPY_WRITE_BUFFER, total, NULL, flags);
+		mapped = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags);
+	}
+	if (!mapped) {
+		// Immutable storage cannot be respecified, start from a fresh name for the fallback
+		if (bufferStorage) {
+			storage = GLBuffer::create();
+			glBindBuffer(GL_COPY_WRITE_BUFFER, storage.get());
+		}
+		glBufferData(GL_COPY_WRITE_BUFFER, total, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	std::cout << "Stream buffer: " << regionCount << " x " << regionSize / 1024 << " KB, "
+		<< (mapped ? "persistent mapping" : "unsynchronized maps") << std::endl;
+}
+
+void StreamBuffer::cleanup()
+{
+	for (int i = 0; i < regionCount; ++i) {
+		if (fences[i])
+			glDeleteSync(fences[i]);
+		fences[i] = 0;
+	}
+
+	if (mapped) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, storage.get());
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		mapped = NULL;
+	}
+	storage.reset();
+}
+
+void StreamBuffer::beginFrame()
+{
+	used = 0;
+
+	GLsync &fence = fences[region];
+	if (fence) {
+		if (!Signalled(fence)) {
+			// Every region is still queued: the GPU is more than regionCount frames behind
+			auto start = std::chrono::steady_clock::now();
+			GLenum status;
+			do {
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			} while (status == GL_TIMEOUT_EXPIRED);
+			waits++;
+			waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	// A single buffer would make this frame's writes wait for the previous frame's draws
+	GLsync previous = fences[(region + regionCount - 1) % regionCount];
+	gpuBehind = previous && !Signalled(previous);
+}
+
+GLintptr StreamBuffer::write(const void *data, size_t bytes, size_t alignment)
+{
+	size_t start = (used + alignment - 1) / alignment * alignment;
+	if (start + bytes > regionSize) {
+		overflows++;
+		return -1;
+	}
+	used = start + bytes;
+
+	GLintptr offset = (GLintptr)(region * regionSize + start);
+	if (mapped) {
+		memcpy(mapped + offset, data, bytes);
+	} else {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, storage.get());
+		void *destination = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, bytes,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (destination) {
+			memcpy(destination, data, bytes);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	bytesStreamed += bytes;
+	if (gpuBehind)
+		stallsAvoided++;
+	return offset;
+}
+
+size_t StreamBuffer::available(size_t alignment) const
+{
+	size_t start = (used + alignment - 1) / alignment * alignment;
+	return start < regionSize ? regionSize - start : 0;
+}
+
+void StreamBuffer::endFrame()
+{
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	lastFrameBytes = used;
+	region = (region + 1) % regionCount;
+}
@@ -0,0 +1,59 @@
+#ifndef _STREAMBUFFER_H_
+#define _STREAMBUFFER_H_
+
+#include <glad/gl.h>
+#include "glresource.h"
+
+#include <cstddef>
+
+// Ring buffer for data rewritten every frame, such as instance transforms and per-frame uniforms.
+// The buffer is split into one region per frame in flight. A frame writes only into its own
+// region, and a fence placed at endFrame() tells a later frame when the GPU has finished reading
+// it, so writes never synchronise with draws still in flight.
+// With GL_ARB_buffer_storage the buffer is mapped once, persistently and coherently, and writes
+// are plain copies. Otherwise each write maps its range with GL_MAP_UNSYNCHRONIZED_BIT, which is
+// safe for the same reason.
+class StreamBuffer {
+public:
+	explicit StreamBuffer(size_t bytesPerFrame = 256 * 1024, int framesInFlight = 3);
+
+	// Needs the GL context. load resolves glBufferStorage, which a 3.3 loader does not provide.
+	void initialize(GLADloadfunc load);
+	void cleanup();
+
+	// Wait, if at all, for the GPU to release this frame's region. Call before the first write.
+	void beginFrame();
+
+	// Copy bytes into this frame's region at a multiple of alignment and return their offset in
+	// buffer(), or -1 if the region is full. The data must be read by this frame's draws only.
+	GLintptr write(const void *data, size_t bytes, size_t alignment = 16);
+
+	// Bytes a write at this alignment could still place in this frame's region
+	size_t available(size_t alignment = 16) const;
+
+	// Fence the region after the frame's last draw reading from it
+	void endFrame();
+
+	GLuint buffer() const { return storage.get(); }
+	bool persistent() const { return mapped != NULL; }
+
+	size_t lastFrameBytes = 0;				// Bytes of its region the previous frame used
+	unsigned long long bytesStreamed = 0;
+	unsigned long stallsAvoided = 0;		// Writes made while the GPU was still reading an earlier region
+	unsigned long waits = 0;				// Frames that had to wait for their region anyway
+	double waitMs = 0.0;
+	unsigned long overflows = 0;			// Writes refused because the region was full
+
+private:
+	size_t regionSize;
+	int regionCount;
+	int region = 0;
+	size_t used = 0;
+	bool gpuBehind = false;
+
+	GLBuffer storage;
+	unsigned char *mapped = NULL;			// Whole buffer when persistently mapped
+	GLsync fences[8] = {};
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "terrainmesher.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+
+TerrainMesher::TerrainMesher(int gridSize)
+	: size(gridSize)
+{
+	// Triangles are numbered level by level below the two halves of the square (ids 2 and 3),
+	// so every triangle comes before its children; the finest level has two per cell
+	int triangleCount = 2 * size * size - 2;
+	hypotenuses.resize(triangleCount * 4);
+
+	for (int i = 0; i < triangleCount; ++i) {
+		int id = i + 2;
+		int ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+		if (id & 1) {
+			bx = by = cx = size;
+		} else {
+			ax = ay = cy = size;
+		}
+
+		// The lowest bit of id picks the root half and each bit above it the child below
+		while ((id >>= 1) > 1) {
+			int mx = (ax + bx) >> 1;
+			int my = (ay + by) >> 1;
+			if (id & 1) {
+				bx = ax; by = ay;
+				ax = cx; ay = cy;
+			} else {
+				ax = bx; ay = by;
+				bx = cx; by = cy;
+			}
+			cx = mx;
+			cy = my;
+		}
+
+		unsigned short *h = &hypotenuses[i * 4];
+		h[0] = (unsigned short)ax;
+		h[1] = (unsigned short)ay;
+		h[2] = (unsigned short)bx;
+		h[3] = (unsigned short)by;
+	}
+}
+
+void TerrainMesher::computeErrors(const float *heights, std::vector<float> &errors) const
+{
+	int side = size + 1;
+	errors.assign(side * side, 0.0f);
+
+	// Forcing the border in also forces in every triangle above it
+	for (int i = 0; i < side; ++i) {
+		errors[i] = FLT_MAX;
+		errors[size * side + i] = FLT_MAX;
+		errors[i * side] = FLT_MAX;
+		errors[i * side + size] = FLT_MAX;
+	}
+
+	// Finest triangles first, so each midpoint sees its children's final errors
+	int triangleCount = (int)hypotenuses.size() / 4;
+	int parentCount = triangleCount - size * size;
+	for (int i = triangleCount - 1; i >= 0; --i) {
+		const unsigned short *h = &hypotenuses[i * 4];
+		int ax = h[0], ay = h[1], bx = h[2], by = h[3];
+		int mx = (ax + bx) >> 1;
+		int my = (ay + by) >> 1;
+		int middle = my * side + mx;
+
+		float interpolated = 0.5f * (heights[ay * side + ax] + heights[by * side + bx]);
+		float error = std::max(errors[middle], std::fabs(interpolated - heights[middle]));
+
+		if (i < parentCount) {
+			// The right angle, and so the children's hypotenuse midpoints
+			int cx = mx + my - ay;
+			int cy = my + ax - mx;
+			error = std::max(error, errors[((ay + cy) >> 1) * side + ((ax + cx) >> 1)]);
+			error = std::max(error, errors[((by + cy) >> 1) * side + ((bx + cx) >> 1)]);
+		}
+		errors[middle] = error;
+	}
+}
+
+int TerrainMesher::triangulate(const std::vector<float> &errors, float maxError, std::vector<unsigned int> &indices) const
+{
+	size_t first = indices.size();
+	split(errors.data(), maxError, 0, 0, size, size, size, 0, indices);
+	split(errors.data(), maxError, size, size, 0, 0, 0, size, indices);
+	return (int)((indices.size() - first) / 3);
+}
+
+void TerrainMesher::split(const float *errors, float maxError, int ax, int ay, int bx, int by, int cx, int cy,
+	std::vector<unsigned int> &indices) const
+{
+	int side = size + 1;
+	int mx = (ax + bx) >> 1;
+	int my = (ay + by) >> 1;
+
+	if (std::abs(ax - cx) + std::abs(ay - cy) > 1 && errors[my * side + mx] > maxError) {
+		split(errors, maxError, cx, cy, ax, ay, mx, my, indices);
+		split(errors, maxError, bx, by, cx, cy, mx, my, indices);
+	} else {
+		indices.push_back(ay * side + ax);
+		indices.push_back(by * side + bx);
+		indices.push_back(cy * side + cx);
+	}
+}
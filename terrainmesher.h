@@ -0,0 +1,39 @@
+#ifndef _TERRAINMESHER_H_
+#define _TERRAINMESHER_H_
+
+#include <vector>
+
+// Adaptive triangulation of square heightmaps as a right-triangulated irregular network (RTIN):
+// starting from the two halves of the square, each right triangle is split at the midpoint of
+// its hypotenuse until dropping that midpoint would move the surface by no more than the
+// requested error. The error of every sample is computed once per heightmap, after which a mesh
+// for any error is a single walk of the triangle hierarchy.
+// The mesher only holds tables shared by all heightmaps of its size, so one instance can be
+// used by any number of threads at once.
+class TerrainMesher {
+public:
+	// gridSize cells along each side, a power of two. Heightmaps have (gridSize + 1)^2 samples, row-major.
+	explicit TerrainMesher(int gridSize);
+
+	// Vertical error of leaving out each sample, including everything that would go with it.
+	// Border samples are never left out, so tiles meshed at different errors still share every
+	// edge vertex and meet without cracks.
+	void computeErrors(const float *heights, std::vector<float> &errors) const;
+
+	// Appends the triangles of the coarsest mesh within maxError, as sample indices, and
+	// returns how many there are
+	int triangulate(const std::vector<float> &errors, float maxError, std::vector<unsigned int> &indices) const;
+
+	int gridSize() const { return size; }
+	int sampleCount() const { return (size + 1) * (size + 1); }
+	int fullTriangleCount() const { return 2 * size * size; }
+
+private:
+	void split(const float *errors, float maxError, int ax, int ay, int bx, int by, int cx, int cy,
+		std::vector<unsigned int> &indices) const;
+
+	int size;
+	std::vector<unsigned short> hypotenuses;	// ax, ay, bx, by of every triangle in the hierarchy, coarsest first
+};
+
+#endif
@@ -2,70 +2,101 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "scenewindow.h"
+#include "flycamera.h"
+#include "chunkstreamer.h"
+#include "noise.h"
+#include "terrainmesher.h"
+#include "threadpool.h"
+#include "glresource.h"
+#include "shader.h"
 
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
 
-#include <unordered_set>
 #include <vector>
-#include <tuple>
 #include <cmath>
 #include <random>
-#include <unordered_map>
-
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb/stb_image.h>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
 
 static GLFWwindow* window;
 static int windowWidth = 1024;
 static int windowHeight = 768;
 
-//setting up user controls
-static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mode);
-static void mouse_callback(GLFWwindow *window, double xpos, double ypos);
-void handleCameraMovement(GLFWwindow* window);
-
-// Camera parameters
-static glm::vec3 cameraPos(0.0f, 50.0f, 0.0f);  // High up
-static glm::vec3 cameraFront(0.0f, -1.0f, 0.0f); // Look downward at an angle
-
-static glm::vec3 cameraUp(0.0f, 1.0f, 0.0f);
-static float cameraSpeed = 0.1f;
-static float yaw = -90.0f;
-static float pitch = -30.0f;
-static float lastX = windowWidth / 2.0f;
-static float lastY = windowHeight / 2.0f;
-static bool firstMouse = true;
+// Camera variables
+static FlyCamera camera(glm::vec3(0.0f, 50.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), -90.0f, -30.0f, 0.1f);
 
 // Infinite terrain parameters
 static const float cellSize = 10.0f;
 static const int renderDistance = 3; // Distance in grid tiles
-static const int gridResolution = 10; // Perlin grid resolution
+static const int gridResolution = 10; // Perlin grid resolution, in cells per noise lattice cell
 static const float heightScale = 18.0f; // Scale Perlin noise height
 
-// Custom hash function for std::tuple<int, int>
-struct TupleHash {
-    template <typename T1, typename T2>
-    std::size_t operator()(const std::tuple<T1, T2>& t) const {
-        auto h1 = std::hash<T1>{}(std::get<0>(t));
-        auto h2 = std::hash<T2>{}(std::get<1>(t));
-        return h1 ^ (h2 << 1);
-    }
-};
-
-std::unordered_set<std::tuple<int, int>, TupleHash> renderedTiles;
-
 // OpenGL shader program
-GLuint programID;
+GLProgram program;
 
 // Infinite terrain parameters
 static const int tileSize = 16; // Number of grid points per tile
 static const float tileWorldSize = (tileSize - 1) * cellSize;
 
-std::unordered_map<std::tuple<int, int>, GLuint, TupleHash> tileVAOs;
+// Tiles are sampled on a finer heightmap and meshed adaptively: flat ground gets a few large
+// triangles, hills as many as they need to stay within pixelError of the full heightmap
+static const int tileGridSize = 64; // Heightmap cells along each side of a tile, a power of two
+static const float tileSpacing = tileWorldSize / tileGridSize;
+static float pixelError = 1.0f; // Screen-space error allowed by the mesher, --error N
+static const float minMeshError = 0.01f; // World-space error of detail level 0
+static const int maxDetailLevel = 12;
+
+static const float fieldOfView = 45.0f;
+
+// Error tables shared by every tile, read-only so all workers use it at once
+static const TerrainMesher mesher(tileGridSize);
+
+// Sample positions and normals of one tile and the mesher's error hierarchy for them. Built
+// once per tile by a worker; workers remeshing the tile for another error hold on to it.
+struct TileSurface {
+    std::vector<float> vertices;
+    std::vector<float> errors;
+};
+
+// GL objects of one tile slot, refilled with whichever tile the slot holds
+struct TerrainTile {
+    GLVertexArray vertexArray;
+    GLBuffer vertexBuffer;
+    GLBuffer indexBuffer;
+    int indexCount = 0;        // 0 until the tile's first mesh arrives, nothing is drawn before
+    int generation = 0;        // Changes whenever the slot takes a new tile
+    int level = -1;            // Detail level of the last mesh requested
+    bool meshing = false;      // A worker is building a mesh for the slot
+    std::shared_ptr<const TileSurface> surface;
+};
+
+// A mesh finished by a worker, waiting for the GL thread to upload it
+struct TileMesh {
+    int tileX;
+    int tileZ;
+    int generation;
+    int level;
+    std::shared_ptr<const TileSurface> surface;    // Set when the job also built the tile's surface
+    std::vector<unsigned int> indices;
+};
+
+// Tiles within renderDistance of the camera. Crossing a tile boundary refills only the slots
+// of the row or column that scrolled out of range, with the tiles that scrolled in.
+ChunkRing<TerrainTile> tileRing(tileWorldSize, renderDistance);
+static int tileGenerations = 0;
+
+std::deque<TileMesh> finishedTiles;
+std::mutex finishedTilesMutex;
+static int tilesMeshed = 0;          // Jobs finished and the worker time they took, guarded by finishedTilesMutex
+static double mesherSeconds = 0.0;
+ThreadPool tileWorkers;
 
 // Vertex and Fragment Shader source
 const char* vertexShaderSource = R"(
@@ -104,90 +135,47 @@ void main() {
 
 )";
 
-float lerp(float a, float b, float t) {
-    return a + t * (b - a);
+// Rolling hills gridResolution cells across, with smaller bumps on top
+static float terrainHeight(float x, float z) {
+    float scale = 1.0f / (gridResolution * cellSize);
+    float noiseValue = GradientNoise2D(x * scale, z * scale) + 0.25f * GradientNoise2D(x * scale * 4.0f, z * scale * 4.0f, 54321);
+    noiseValue = (noiseValue * 0.8f + 1.0f) * 0.5f; // Normalize to [0, 1]
+    return noiseValue * heightScale;
 }
 
-float fade(float t) {
-    return t * t * t * (t * (t * 6 - 15) + 10);
-}
-
-// Use a global seed for consistent noise across tiles
-static const unsigned int NOISE_SEED = 12345;
-
-glm::vec2 randomGradient(int ix, int iy) {
-    unsigned int seed = NOISE_SEED + 3251 * ix + 8741 * iy;
-    seed = (seed << 13) ^ seed;
-    unsigned int hashed = (seed * (seed * seed * 15731 + 789221) + 1376312589) & 0x7fffffff;
-
-    float angle = hashed % 360 * (M_PI / 180.0f);
-    return glm::vec2(cos(angle), sin(angle));
-}
-
-float dotGridGradient(int ix, int iy, float x, float y) {
-    glm::vec2 gradient = randomGradient(ix, iy);
-    glm::vec2 distance = glm::vec2(x - (float)ix, y - (float)iy);
-    return glm::dot(gradient, distance);
-}
-
-float perlin(float x, float y) {
-    int x0 = (int)floor(x);
-    int x1 = x0 + 1;
-    int y0 = (int)floor(y);
-    int y1 = y0 + 1;
-
-    float sx = fade(x - (float)x0);
-    float sy = fade(y - (float)y0);
-
-    float n0, n1, ix0, ix1;
-    n0 = dotGridGradient(x0, y0, x, y);
-    n1 = dotGridGradient(x1, y0, x, y);
-    ix0 = lerp(n0, n1, sx);
-
-    n0 = dotGridGradient(x0, y1, x, y);
-    n1 = dotGridGradient(x1, y1, x, y);
-    ix1 = lerp(n0, n1, sx);
-
-    return lerp(ix0, ix1, sy);
-}
-
-std::vector<float> generateHeightMap(int gridResolution, float tileOffsetX, float tileOffsetZ, float cellSize) {
+void generateHeightMap(std::vector<float>& heightMap, int gridResolution, float tileOffsetX, float tileOffsetZ, float cellSize) {
     int totalResolution = gridResolution + 1; // Standard grid size with shared edges
-    std::vector<float> heightMap(totalResolution * totalResolution);
+    heightMap.resize(totalResolution * totalResolution);
 
     for (int z = 0; z < totalResolution; ++z) {
         for (int x = 0; x < totalResolution; ++x) {
             float fx = tileOffsetX + x * cellSize;
             float fz = tileOffsetZ + z * cellSize;
 
-            float noiseValue = perlin(fx, fz);
-            noiseValue = (noiseValue + 1.0f) * 0.5f; // Normalize to [0, 1]
-
-            heightMap[z * totalResolution + x] = noiseValue * heightScale;
+            heightMap[z * totalResolution + x] = terrainHeight(fx, fz);
         }
     }
-    return heightMap;
 }
 
 void renderTiles() {
-    for (const auto& tile : renderedTiles) {
-        GLuint VAO = tileVAOs[tile];
+    GLint modelLocation = glGetUniformLocation(program.get(), "model");
+    tileRing.forEach([&](int tileX, int tileZ, TerrainTile& tile) {
+        if (tile.indexCount == 0)
+            return;
 
         glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(std::get<0>(tile) * tileWorldSize, 0.0f, std::get<1>(tile) * tileWorldSize));
+        model = glm::translate(model, glm::vec3(tileX * tileWorldSize, 0.0f, tileZ * tileWorldSize));
 
-        glUniformMatrix4fv(glGetUniformLocation(programID, "model"), 1, GL_FALSE, &model[0][0]);
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &model[0][0]);
 
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, (tileSize + 1) * (tileSize + 1) * 6, GL_UNSIGNED_INT, 0);
-    }
+        glBindVertexArray(tile.vertexArray.get());
+        glDrawElements(GL_TRIANGLES, tile.indexCount, GL_UNSIGNED_INT, 0);
+    });
 }
 
-void generateTerrainVAO(GLuint& VAO, GLuint& VBO, GLuint& EBO, const std::vector<float>& heightMap, int gridResolution, float cellSize) {
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
-
+void generateTerrainVertices(std::vector<float>& vertices, const std::vector<float>& heightMap, int gridResolution, float cellSize) {
     int totalResolution = gridResolution + 1;
+    vertices.clear();
 
     for (int z = 0; z < totalResolution; ++z) {
         for (int x = 0; x < totalResolution; ++x) {
@@ -201,150 +189,220 @@ void generateTerrainVAO(GLuint& VAO, GLuint& VBO, GLuint& EBO, const std::vector
             vertices.push_back(0.0f);
         }
     }
+}
 
-    for (int z = 0; z < gridResolution; ++z) {
-        for (int x = 0; x < gridResolution; ++x) {
-            int topLeft = z * totalResolution + x;
-            int topRight = topLeft + 1;
-            int bottomLeft = (z + 1) * totalResolution + x;
-            int bottomRight = bottomLeft + 1;
+// World-space error of a detail level, doubling with each level
+static float levelError(int level) {
+    return minMeshError * (float)(1 << level);
+}
 
-            indices.push_back(topLeft);
-            indices.push_back(bottomLeft);
-            indices.push_back(topRight);
+// Coarsest detail level that stays within pixelError when the tile is seen from position
+static int detailLevel(int tileX, int tileZ, const glm::vec3& position) {
+    glm::vec3 low(tileX * tileWorldSize, 0.0f, tileZ * tileWorldSize);
+    glm::vec3 high = low + glm::vec3(tileWorldSize, heightScale, tileWorldSize);
+    float distance = glm::length(position - glm::clamp(position, low, high));
+
+    // Size of one pixel at that distance
+    float pixelSize = distance * 2.0f * std::tan(glm::radians(fieldOfView) * 0.5f) / windowHeight;
+    float error = pixelError * pixelSize;
+    if (error < 2.0f * minMeshError)
+        return 0;
+    return std::min((int)std::log2(error / minMeshError), maxDetailLevel);
+}
 
-            indices.push_back(topRight);
-            indices.push_back(bottomLeft);
-            indices.push_back(bottomRight);
-        }
+// Worker side: builds the tile's surface if there is none yet, then its mesh for the level
+void meshTile(int tileX, int tileZ, int generation, int level, std::shared_ptr<const TileSurface> surface) {
+    auto start = std::chrono::steady_clock::now();
+
+    TileMesh mesh;
+    mesh.tileX = tileX;
+    mesh.tileZ = tileZ;
+    mesh.generation = generation;
+    mesh.level = level;
+
+    if (!surface) {
+        thread_local std::vector<float> heightMap;
+        auto built = std::make_shared<TileSurface>();
+        generateHeightMap(heightMap, tileGridSize, tileX * tileWorldSize, tileZ * tileWorldSize, tileSpacing);
+        generateTerrainVertices(built->vertices, heightMap, tileGridSize, tileSpacing);
+        mesher.computeErrors(heightMap.data(), built->errors);
+        surface = built;
+        mesh.surface = built;
     }
+    mesh.indices.reserve(mesher.fullTriangleCount() * 3);
+    mesher.triangulate(surface->errors, levelError(level), mesh.indices);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(finishedTilesMutex);
+    finishedTiles.push_back(std::move(mesh));
+    tilesMeshed++;
+    mesherSeconds += seconds;
+}
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+void requestMesh(int tileX, int tileZ, TerrainTile& tile, int level) {
+    tile.level = level;
+    tile.meshing = true;
+    int generation = tile.generation;
+    std::shared_ptr<const TileSurface> surface = tile.surface;
+    tileWorkers.submit([tileX, tileZ, generation, level, surface]() {
+        meshTile(tileX, tileZ, generation, level, surface);
+    });
+}
 
-    glBindVertexArray(VAO);
+void updateVisibleTiles(glm::vec3 position) {
+    // Slots taking a new tile drop the old one's mesh and surface straight away
+    tileRing.update(position, [&](int tileX, int tileZ, TerrainTile& tile) {
+        tile.generation = ++tileGenerations;
+        tile.indexCount = 0;
+        tile.surface.reset();
+        requestMesh(tileX, tileZ, tile, detailLevel(tileX, tileZ, position));
+    });
+
+    // Remesh the tiles the camera has moved closer to or away from, one job per tile at a time
+    tileRing.forEach([&](int tileX, int tileZ, TerrainTile& tile) {
+        if (tile.meshing || !tile.surface)
+            return;
+        int level = detailLevel(tileX, tileZ, position);
+        if (level != tile.level)
+            requestMesh(tileX, tileZ, tile, level);
+    });
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+// GL side: upload the meshes the workers have finished, unless their slot has moved on
+void uploadFinishedTiles() {
+    std::deque<TileMesh> finished;
+    {
+        std::lock_guard<std::mutex> lock(finishedTilesMutex);
+        finished.swap(finishedTiles);
+    }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    for (TileMesh& mesh : finished) {
+        TerrainTile* tile = tileRing.find(mesh.tileX, mesh.tileZ);
+        if (tile == NULL || tile->generation != mesh.generation)
+            continue;
+        tile->meshing = false;
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+        if (!tile->vertexArray) {
+            tile->vertexArray = GLVertexArray::create();
+            tile->vertexBuffer = GLBuffer::create();
+            tile->indexBuffer = GLBuffer::create();
 
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+            glBindVertexArray(tile->vertexArray.get());
+            glBindBuffer(GL_ARRAY_BUFFER, tile->vertexBuffer.get());
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, tile->indexBuffer.get());
 
-    glBindVertexArray(0);
-}
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
 
-void generateTile(int tileX, int tileZ) {
-    float tileOffsetX = tileX * tileWorldSize;
-    float tileOffsetZ = tileZ * tileWorldSize;
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
 
-    std::vector<float> heightMap = generateHeightMap(tileSize, tileOffsetX, tileOffsetZ, tileWorldSize / tileSize);
+            glBindVertexArray(0);
+        }
 
-    GLuint VAO, VBO, EBO;
-    generateTerrainVAO(VAO, VBO, EBO, heightMap, tileSize, tileWorldSize / tileSize);
+        // Respecifying the whole buffer lets the driver orphan the storage the GPU may still be
+        // drawing the slot's previous tile from, instead of waiting for it
+        if (mesh.surface) {
+            tile->surface = mesh.surface;
+            glBindBuffer(GL_ARRAY_BUFFER, tile->vertexBuffer.get());
+            glBufferData(GL_ARRAY_BUFFER, mesh.surface->vertices.size() * sizeof(float), mesh.surface->vertices.data(), GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
 
-    tileVAOs[std::make_tuple(tileX, tileZ)] = VAO;
+        // The element buffer binding belongs to the VAO
+        glBindVertexArray(tile->vertexArray.get());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_DYNAMIC_DRAW);
+        glBindVertexArray(0);
+        tile->indexCount = (int)mesh.indices.size();
+    }
 }
 
-void updateVisibleTiles(glm::vec3 position) {
-    int currentTileX = (int)floor(position.x / tileWorldSize);
-    int currentTileZ = (int)floor(position.z / tileWorldSize);
-
-    std::unordered_set<std::tuple<int, int>, TupleHash> newTiles;
-
-    for (int x = -renderDistance; x <= renderDistance; ++x) {
-        for (int z = -renderDistance; z <= renderDistance; ++z) {
-            int tileX = currentTileX + x;
-            int tileZ = currentTileZ + z;
+// Triangles drawn against a full-resolution mesh of the same tiles, and the mesher's throughput
+void renderStats(float frameRate) {
+    long triangles = 0;
+    long fullTriangles = 0;
+    tileRing.forEach([&](int, int, TerrainTile& tile) {
+        if (tile.indexCount == 0)
+            return;
+        triangles += tile.indexCount / 3;
+        fullTriangles += mesher.fullTriangleCount();
+    });
+
+    int meshed;
+    double seconds;
+    {
+        std::lock_guard<std::mutex> lock(finishedTilesMutex);
+        meshed = tilesMeshed;
+        seconds = mesherSeconds;
+        tilesMeshed = 0;
+        mesherSeconds = 0.0;
+    }
 
-            auto tile = std::make_tuple(tileX, tileZ);
-            newTiles.insert(tile);
+    std::ostringstream ss;
+    ss << "Infinite Terrain with Perlin Noise - FPS: " << (int)frameRate << "  triangles: " << triangles;
+    if (fullTriangles > 0)
+        ss << " (" << (int)(100 * (fullTriangles - triangles) / fullTriangles) << "% saved)";
+    if (seconds > 0.0)
+        ss << "  mesher: " << (int)(meshed / seconds) << " tiles/s per thread";
+    glfwSetWindowTitle(window, ss.str().c_str());
+}
 
-            if (renderedTiles.find(tile) == renderedTiles.end()) {
-                generateTile(tileX, tileZ);
-                renderedTiles.insert(tile);
-            }
-        }
-    }
+// Release every slot's GL objects, they stay queued until the deletion queue is flushed
+void cleanupTiles() {
+    tileRing.forEach([](int, int, TerrainTile& tile) {
+        tile = TerrainTile();
+    });
+}
 
-    for (auto it = renderedTiles.begin(); it != renderedTiles.end();) {
-        if (newTiles.find(*it) == newTiles.end()) {
-            GLuint VAO = tileVAOs[*it];
-            glDeleteVertexArrays(1, &VAO);
-            tileVAOs.erase(*it);
-            it = renderedTiles.erase(it);
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--error") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0.0) {
+            pixelError = (float)atof(argv[++i]);
         } else {
-            ++it;
+            std::cerr << "Usage: terrainperlinnoise [--error PIXELS]" << std::endl;
+            return 1;
         }
     }
-}
 
-int main() {
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
+    SceneWindowOptions options;
+    options.captureCursor = true;
+    window = CreateSceneWindow("Infinite Terrain with Perlin Noise", options);
+    if (window == NULL)
         return -1;
-    }
+    AttachFlyCamera(window, &camera);
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glEnable(GL_DEPTH_TEST);
 
-    window = glfwCreateWindow(windowWidth, windowHeight, "Infinite Terrain with Perlin Noise", NULL, NULL);
-    if (!window) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
+    program = GLProgram(LoadShadersFromString(vertexShaderSource, fragmentShaderSource));
+    if (!program) {
+        std::cerr << "Failed to load terrain shaders." << std::endl;
         glfwTerminate();
         return -1;
     }
-    glfwMakeContextCurrent(window);
-    
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetKeyCallback(window, key_callback);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-    if (!gladLoadGL(glfwGetProcAddress)) {
-        std::cerr << "Failed to initialize GLAD" << std::endl;
-        return -1;
-    }
-
-    glEnable(GL_DEPTH_TEST);
-
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
 
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    programID = glCreateProgram();
-    glAttachShader(programID, vertexShader);
-    glAttachShader(programID, fragmentShader);
-    glLinkProgram(programID);
+    glClearColor(0.5f, 0.7f, 1.0f, 1.0f);
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // Start with every tile in range rather than have them pop in over the first frames
+    updateVisibleTiles(camera.position);
+    tileWorkers.waitIdle();
+    uploadFinishedTiles();
 
-    glClearColor(0.5f, 0.7f, 1.0f, 1.0f);
+    double lastTime = glfwGetTime();
+    int frames = 0;
 
     while (!glfwWindowShouldClose(window)) {
-        handleCameraMovement(window);
-        updateVisibleTiles(cameraPos);
+        camera.move(window);
+        updateVisibleTiles(camera.position);
+        uploadFinishedTiles();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUseProgram(programID);
+        glUseProgram(program.get());
 
-        glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-        glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)windowWidth / windowHeight, 0.1f, 1000.0f);
+        glm::mat4 view = camera.view();
+        glm::mat4 projection = glm::perspective(glm::radians(fieldOfView), (float)windowWidth / windowHeight, 0.1f, 1000.0f);
 
-        glUniformMatrix4fv(glGetUniformLocation(programID, "view"), 1, GL_FALSE, &view[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(programID, "projection"), 1, GL_FALSE, &projection[0][0]);
+        glUniformMatrix4fv(glGetUniformLocation(program.get(), "view"), 1, GL_FALSE, &view[0][0]);
+        glUniformMatrix4fv(glGetUniformLocation(program.get(), "projection"), 1, GL_FALSE, &projection[0][0]);
 
         renderTiles();
 
@@ -353,63 +411,25 @@ int main() {
             std::cerr << "OpenGL Error: " << err << std::endl;
         }
 
+        frames++;
+        double currentTime = glfwGetTime();
+        if (currentTime - lastTime >= 1.0) {
+            renderStats(frames / (currentTime - lastTime));
+            frames = 0;
+            lastTime = currentTime;
+        }
+
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
-    glfwTerminate();
-    return 0;
-}
-
-void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
-    if (firstMouse) {
-        lastX = xpos;
-        lastY = ypos;
-        firstMouse = false;
-    }
-
-    float xoffset = xpos - lastX;
-    float yoffset = lastY - ypos; // Reversed since y-coordinates range from bottom to top
-    lastX = xpos;
-    lastY = ypos;
+    tileWorkers.shutdown();
+    cleanupTiles();
+    program.reset();
 
-    float sensitivity = 0.1f;
-    xoffset *= sensitivity;
-    yoffset *= sensitivity;
+    // Everything released above is still queued, delete it while the context exists
+    DefaultDeletionQueue().flush();
 
-    yaw += xoffset;
-    pitch += yoffset;
-
-    if (pitch > 89.0f)
-        pitch = 89.0f;
-    if (pitch < -89.0f)
-        pitch = -89.0f;
-
-    glm::vec3 front;
-    front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
-    front.y = sin(glm::radians(pitch));
-    front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-    cameraFront = glm::normalize(front);
-}
-
-void handleCameraMovement(GLFWwindow* window) {
-    glm::vec3 direction(0.0f);
-
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        direction += cameraFront;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        direction -= cameraFront;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        direction -= glm::normalize(glm::cross(cameraFront, cameraUp));
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        direction += glm::normalize(glm::cross(cameraFront, cameraUp));
-
-    if (glm::length(direction) > 0.0f)
-        cameraPos += glm::normalize(direction) * cameraSpeed;
-}
-
-
-void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
-		glfwSetWindowShouldClose(window, GL_TRUE);
+    glfwTerminate();
+    return 0;
 }
@@ -0,0 +1,95 @@
+// Offline texture baker: converts source images to block-compressed DDS files with a full mip chain.
+//
+//   texturebake [--bc3] [--verify] ../FinalProject/tile4.jpg ../FinalProject/facade0.jpg ...
+//
+// Each input is written next to itself with a .dds extension, which AsyncTextureLoader picks up
+// in preference to the original. BC1 is used unless --bc3 is given or the image has alpha.
+// --verify decodes level 0 in software and reports the PSNR against the source, no GPU needed.
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include "dds.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static double ComputePSNR(const unsigned char *a, const unsigned char *b, size_t pixels)
+{
+	double squaredError = 0.0;
+	for (size_t i = 0; i < pixels; ++i) {
+		for (int c = 0; c < 3; ++c) {
+			double d = (double)a[i * 4 + c] - (double)b[i * 4 + c];
+			squaredError += d * d;
+		}
+	}
+	double mse = squaredError / (pixels * 3.0);
+	return mse == 0.0 ? INFINITY : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+int main(int argc, char **argv)
+{
+	bool forceBC3 = false;
+	bool verify = false;
+	std::vector<std::string> inputs;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--bc3") == 0)
+			forceBC3 = true;
+		else if (strcmp(argv[i], "--verify") == 0)
+			verify = true;
+		else
+			inputs.push_back(argv[i]);
+	}
+
+	if (inputs.empty()) {
+		std::cerr << "Usage: texturebake [--bc3] [--verify] image..." << std::endl;
+		return 1;
+	}
+
+	int failures = 0;
+	for (const std::string &input : inputs) {
+		int w, h, channels;
+		unsigned char *rgba = stbi_load(input.c_str(), &w, &h, &channels, 4);
+		if (!rgba) {
+			std::cerr << "Failed to load texture " << input << std::endl;
+			failures++;
+			continue;
+		}
+
+		DDSFormat format = (forceBC3 || channels == 4) ? DDS_BC3 : DDS_BC1;
+		std::string output = BakedTexturePath(input);
+		if (!BakeDDS(output.c_str(), rgba, w, h, format)) {
+			std::cerr << "Failed to write " << output << std::endl;
+			stbi_image_free(rgba);
+			failures++;
+			continue;
+		}
+
+		// Compare against what the runtime path used to keep in memory: RGB8 plus a 1/3 mip overhead
+		DDSImage baked;
+		if (!LoadDDS(output.c_str(), baked)) {
+			std::cerr << "Failed to read back " << output << std::endl;
+			stbi_image_free(rgba);
+			failures++;
+			continue;
+		}
+		double rawBytes = (double)w * h * 3 * 4.0 / 3.0;
+		std::cout << input << " -> " << output << " (" << w << "x" << h << ", "
+			<< (format == DDS_BC1 ? "BC1" : "BC3") << ", " << baked.mipCount << " mips, "
+			<< baked.dataSize << " bytes, " << rawBytes / baked.dataSize << "x smaller than RGB8)" << std::endl;
+
+		if (verify) {
+			std::vector<unsigned char> decoded((size_t)w * h * 4);
+			DecompressImage(baked.format, baked.data, w, h, decoded.data());
+			std::cout << "  level 0 PSNR: " << ComputePSNR(rgba, decoded.data(), (size_t)w * h) << " dB" << std::endl;
+		}
+
+		stbi_image_free(rgba);
+	}
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,304 @@
+#include "textureloader.h"
+#include "assetpack.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// Bytes memcpy'd into the PBO per slice, before the time budget is checked again
+static const size_t sliceBytes = 256 * 1024;
+
+static bool HasExtension(const char *name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && strcmp(extension, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+AsyncTextureLoader::AsyncTextureLoader(unsigned int threadCount)
+	: workers(threadCount)
+{
+}
+
+AsyncTextureLoader::~AsyncTextureLoader()
+{
+	workers.shutdown();
+	for (DecodedTexture &texture : decoded)
+		release(texture);
+	if (uploading)
+		release(active);
+}
+
+void AsyncTextureLoader::release(DecodedTexture &texture)
+{
+	texture.levels = std::vector<unsigned char>();
+	texture.levelOffsets.clear();
+	texture.dds = DDSImage();
+}
+
+// Runs on a worker thread
+void AsyncTextureLoader::decode(DecodedTexture &result, bool compressionSupported)
+{
+	// Prefer the baked, block-compressed version of the file. From the asset pack the
+	// image points straight into the mapping and is only copied once, into the PBO.
+	AssetPack &pack = DefaultAssetPack();
+	std::string bakedPath = BakedTexturePath(result.path);
+	const unsigned char *packed;
+	size_t packedSize;
+	bool baked = pack.find(bakedPath, &packed, &packedSize) ? ParseDDS(packed, packedSize, result.dds)
+		: LoadDDS(bakedPath.c_str(), result.dds);
+
+	if (baked) {
+		result.width = result.dds.width;
+		result.height = result.dds.height;
+		if (compressionSupported) {
+			result.compressed = true;
+			return;
+		}
+
+		// No S3TC on this context: expand the baked levels in software and upload them like a regular image
+		result.channels = 4;
+		int w = result.width, h = result.height;
+		for (int level = 0; level < result.dds.mipCount; ++level) {
+			result.levelOffsets.push_back(result.levels.size());
+			result.levels.resize(result.levels.size() + (size_t)w * h * 4);
+			DecompressImage(result.dds.format, result.dds.data + result.dds.mipOffsets[level],
+				w, h, result.levels.data() + result.levelOffsets.back());
+			w = std::max(1, w / 2);
+			h = std::max(1, h / 2);
+		}
+		result.dds = DDSImage();
+		return;
+	}
+
+	int channels;
+	unsigned char *pixels;
+	result.channels = 3;
+	if (pack.find(result.path, &packed, &packedSize))
+		pixels = stbi_load_from_memory(packed, (int)packedSize, &result.width, &result.height, &channels, 3);
+	else
+		pixels = stbi_load(result.path.c_str(), &result.width, &result.height, &channels, 3);
+	if (!pixels)
+		return;
+
+	// Filter the mips here rather than with glGenerateMipmap, which would run on the render thread
+	BuildMipChain(pixels, result.width, result.height, result.channels, result.levels, result.levelOffsets);
+	stbi_image_free(pixels);
+}
+
+GLuint AsyncTextureLoader::load(const char *texture_file_path)
+{
+	auto found = textures.find(texture_file_path);
+	if (found != textures.end())
+		return found->second;
+
+	if (!capabilitiesQueried) {
+		compressionSupported = HasExtension("GL_EXT_texture_compression_s3tc");
+		capabilitiesQueried = true;
+	}
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	// To tile textures on a box, we set wrapping to repeat
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Placeholder until the real image arrives, no mipmaps so the texture is complete
+	const unsigned char grey[3] = { 128, 128, 128 };
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, grey);
+
+	textures[texture_file_path] = texture;
+
+	{
+		std::lock_guard<std::mutex> lock(decodedMutex);
+		inFlight++;
+	}
+
+	std::string path = texture_file_path;
+	bool compressed = compressionSupported;
+	workers.submit([this, texture, path, compressed]() {
+		DecodedTexture result;
+		result.texture = texture;
+		result.path = path;
+		decode(result, compressed);
+
+		std::lock_guard<std::mutex> lock(decodedMutex);
+		decoded.push_back(std::move(result));
+	});
+
+	return texture;
+}
+
+void AsyncTextureLoader::beginUpload(DecodedTexture &next)
+{
+	active = std::move(next);
+	uploading = true;
+	bytesStaged = 0;
+
+	if (pixelBufferID == 0)
+		glGenBuffers(1, &pixelBufferID);
+
+	// Orphan the previous storage so mapping never waits on an earlier transfer
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBufferID);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, active.size(), NULL, GL_STREAM_DRAW);
+	mapped = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, active.size(),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void AsyncTextureLoader::finishUpload()
+{
+	glBindTexture(GL_TEXTURE_2D, active.texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// Source the image from the PBO, the driver copies it without blocking us.
+	// If mapping failed, fall back to a direct upload from client memory.
+	const unsigned char *base = active.source();
+	if (mapped) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBufferID);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		mapped = nullptr;
+		base = nullptr;
+	}
+
+	if (active.compressed) {
+		// Every level was baked offline, nothing to generate at runtime
+		GLenum format = active.dds.format == DDS_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		int w = active.width, h = active.height;
+		for (int level = 0; level < active.dds.mipCount; ++level) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, format, w, h, 0, (GLsizei)active.dds.mipSizes[level],
+				base + active.dds.mipOffsets[level]);
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, active.dds.mipCount - 1);
+		bytesUploaded += (unsigned long)active.size();
+	} else {
+		// The workers filtered the mip chain, each level is just another copy out of the PBO
+		GLenum format = active.channels == 4 ? GL_RGBA : GL_RGB;
+		int w = active.width, h = active.height;
+		int levelCount = (int)active.levelOffsets.size();
+		for (int level = 0; level < levelCount; ++level) {
+			glTexImage2D(GL_TEXTURE_2D, level, format, w, h, 0, format, GL_UNSIGNED_BYTE, base + active.levelOffsets[level]);
+			w = w > 1 ? w / 2 : 1;
+			h = h > 1 ? h / 2 : 1;
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+		bytesUploaded += (unsigned long)active.size();
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+	std::cout << "Texture loaded: " << active.path << (active.compressed ? " (compressed)" : "") << std::endl;
+	texturesUploaded++;
+
+	release(active);
+	uploading = false;
+
+	std::lock_guard<std::mutex> lock(decodedMutex);
+	inFlight--;
+}
+
+void AsyncTextureLoader::update(double budgetSeconds)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto elapsed = [&start]() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	while (elapsed() < budgetSeconds) {
+		if (!uploading) {
+			DecodedTexture next;
+			{
+				std::lock_guard<std::mutex> lock(decodedMutex);
+				if (decoded.empty())
+					return;
+				next = std::move(decoded.front());
+				decoded.pop_front();
+			}
+
+			if (!next.source()) {
+				std::cout << "Failed to load texture " << next.path << std::endl;
+				std::lock_guard<std::mutex> lock(decodedMutex);
+				inFlight--;
+				continue;
+			}
+
+			beginUpload(next);
+		}
+
+		// Copy the next slice into the mapped PBO
+		if (mapped) {
+			size_t bytes = std::min(sliceBytes, active.size() - bytesStaged);
+			memcpy(mapped + bytesStaged, active.source() + bytesStaged, bytes);
+			bytesStaged += bytes;
+		} else {
+			bytesStaged = active.size();
+		}
+
+		if (bytesStaged == active.size())
+			finishUpload();
+	}
+}
+
+size_t AsyncTextureLoader::pending()
+{
+	std::lock_guard<std::mutex> lock(decodedMutex);
+	return inFlight;
+}
+
+void AsyncTextureLoader::shutdown()
+{
+	workers.shutdown();
+
+	if (mapped) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBufferID);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		mapped = nullptr;
+	}
+	if (pixelBufferID != 0) {
+		glDeleteBuffers(1, &pixelBufferID);
+		pixelBufferID = 0;
+	}
+
+	// The loader owns every texture it handed out, callers only borrow them
+	std::vector<GLuint> names;
+	for (auto &entry : textures)
+		names.push_back(entry.second);
+	if (!names.empty())
+		glDeleteTextures((GLsizei)names.size(), names.data());
+	textures.clear();
+}
+
+AsyncTextureLoader &DefaultTextureLoader()
+{
+	static AsyncTextureLoader *loader = new AsyncTextureLoader();
+	return *loader;
+}
+
+GLuint LoadTexture(const char *texture_file_path)
+{
+	return DefaultTextureLoader().load(texture_file_path);
+}
@@ -0,0 +1,88 @@
+#ifndef _TEXTURELOADER_H_
+#define _TEXTURELOADER_H_
+
+#include <glad/gl.h>
+#include "threadpool.h"
+#include "dds.h"
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Loads textures without stalling the render thread.
+// load() returns a texture name at once, backed by a 1x1 grey placeholder.
+// Worker threads decode the image, and update() copies the pixels into a
+// pixel buffer object a slice at a time, within a per-frame time budget.
+// Workers also build the box-filtered mip chain, and once every level is staged the texture is
+// specified from the PBO, so the render thread never generates mipmaps itself.
+// When a baked .dds sibling exists (see texturebake.cpp) its precomputed BC1/BC3 mips are
+// uploaded with glCompressedTexImage2D instead, or decoded in software if S3TC is missing.
+// Files present in DefaultAssetPack() are decoded from the mapping instead of the filesystem.
+class AsyncTextureLoader {
+public:
+	explicit AsyncTextureLoader(unsigned int threadCount = 2);
+	~AsyncTextureLoader();
+
+	// Repeated requests for the same file share one texture
+	GLuint load(const char *texture_file_path);
+
+	// Stage decoded pixels for at most budgetSeconds. Call once per frame on the GL thread.
+	void update(double budgetSeconds);
+
+	// Textures still decoding or uploading
+	size_t pending();
+
+	// Join the workers, release the staging buffer and delete every loaded texture. Needs the GL context.
+	void shutdown();
+
+	unsigned long texturesUploaded = 0;
+	unsigned long bytesUploaded = 0;		// Texture memory specified so far, mips included
+
+private:
+	struct DecodedTexture {
+		GLuint texture;
+		std::string path;
+		int width = 0;
+		int height = 0;
+		int channels = 3;
+		std::vector<unsigned char> levels;		// Uncompressed mip chain, level 0 first
+		std::vector<size_t> levelOffsets;
+		bool compressed = false;
+		DDSImage dds;
+
+		// Bytes staged through the PBO
+		const unsigned char *source() const { return compressed ? dds.data : levels.empty() ? nullptr : levels.data(); }
+		size_t size() const { return compressed ? dds.dataSize : levels.size(); }
+	};
+
+	static void decode(DecodedTexture &result, bool compressionSupported);
+	void release(DecodedTexture &texture);
+
+	void beginUpload(DecodedTexture &decoded);
+	void finishUpload();
+
+	ThreadPool workers;
+	std::unordered_map<std::string, GLuint> textures;
+
+	std::mutex decodedMutex;
+	std::deque<DecodedTexture> decoded;
+	size_t inFlight = 0;
+
+	// Upload currently being staged
+	DecodedTexture active;
+	bool uploading = false;
+	GLuint pixelBufferID = 0;
+	unsigned char *mapped = nullptr;
+	size_t bytesStaged = 0;
+	bool compressionSupported = false;
+	bool capabilitiesQueried = false;
+};
+
+// Loader shared by the scenes. Never destroyed, call shutdown() on it while the context exists.
+AsyncTextureLoader &DefaultTextureLoader();
+
+// DefaultTextureLoader().load(), for scenes that just need a texture
+GLuint LoadTexture(const char *texture_file_path);
+
+#endif
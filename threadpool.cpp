@@ -0,0 +1,80 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	// Leave one core for the render thread
+	if (threadCount == 0) {
+		unsigned int cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < threadCount; ++i) {
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	shutdown();
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+size_t ThreadPool::pending()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return jobs.size() + activeJobs;
+}
+
+void ThreadPool::waitIdle()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this] { return jobs.empty() && activeJobs == 0; });
+}
+
+void ThreadPool::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stopping && workers.empty())
+			return;
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+
+	for (auto& worker : workers) {
+		if (worker.joinable())
+			worker.join();
+	}
+	workers.clear();
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (jobs.empty())
+				return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+			activeJobs++;
+		}
+
+		job();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		activeJobs--;
+		if (jobs.empty() && activeJobs == 0)
+			idle.notify_all();
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling jobs from a shared FIFO queue.
+// Jobs must not touch OpenGL: only the thread owning the context may do that.
+class ThreadPool {
+public:
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void submit(std::function<void()> job);
+
+	// Number of jobs queued or currently running
+	size_t pending();
+
+	// Block until every submitted job has finished
+	void waitIdle();
+
+	// Finish the queued jobs and join the workers
+	void shutdown();
+
+	unsigned int size() const { return (unsigned int)workers.size(); }
+
+private:
+	void workerLoop();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable idle;
+	size_t activeJobs = 0;
+	bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#version 330 core
+
+in vec2 uv;
+in vec3 Normal;
+in vec3 FragPos;
+
+uniform sampler2D texture1;
+uniform vec3 lightColor;      // Color of the light
+
+#include "shadow.glsl"
+
+out vec4 FragColor;
+
+void main() {
+    float ambientStrength = 0.1;
+    vec3 ambient = ambientStrength * lightColor;
+
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = towardsLight.xyz;
+
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightColor * sunVisibility(FragPos, norm);
+
+    vec3 result = (ambient + diffuse);
+
+    result *= texture(texture1, uv).rgb;
+
+    FragColor = vec4(result, 1.0);
+}
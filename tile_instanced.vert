@@ -0,0 +1,27 @@
+#version 330 core
+
+layout(location = 0) in vec3 vertexPosition;        // Vertex position
+layout(location = 1) in vec2 vertexUV;              // Texture coordinates
+layout(location = 2) in vec3 vertexNormal;          // Normal coordinates
+
+// Per-instance input streamed every frame: tile centre in xyz, tile size in w
+layout(location = 3) in vec4 instancePositionScale;
+
+// Per-frame uniforms shared with the building program
+layout(std140) uniform FrameData {
+    mat4 VP;
+};
+
+out vec2 uv;          // Pass UV coordinates to fragment shader
+out vec3 FragPos;     // Pass world position to fragment shader
+out vec3 Normal;      // Pass transformed normals to fragment shader
+
+void main() {
+    // Tiles are flat squares, so the model transform is a uniform scale followed by a translation
+    FragPos = instancePositionScale.xyz + vertexPosition * instancePositionScale.w;
+    gl_Position = VP * vec4(FragPos, 1.0);
+
+    Normal = vertexNormal;
+
+    uv = vertexUV; // Pass UV coordinates
+}
@@ -0,0 +1,126 @@
+#include "tilerenderer.h"
+#include "shader.h"
+#include "textureloader.h"
+
+#include <algorithm>
+#include <iostream>
+
+// Unit quad, position then uv
+static const float tileVertices[20] = {
+	-0.5f, 0.0f, -0.5f, 0.0f, 0.0f,
+	0.5f, 0.0f, -0.5f, 1.0f, 0.0f,
+	0.5f, 0.0f, 0.5f, 1.0f, 1.0f,
+	-0.5f, 0.0f, 0.5f, 0.0f, 1.0f,
+};
+
+static const float tileNormals[12] = {
+	0.0f, 1.0f, 0.0f,
+	0.0f, 1.0f, 0.0f,
+	0.0f, 1.0f, 0.0f,
+	0.0f, 1.0f, 0.0f,
+};
+
+static const unsigned int tileIndices[6] = {
+	0, 1, 2,
+	0, 2, 3,
+};
+
+void TileRenderer::initialize(const char *vertex_file_path, const char *fragment_file_path, const char *texture_file_path)
+{
+	vertexArray = GLVertexArray::create();
+	glBindVertexArray(vertexArray.get());
+
+	vertexBuffer = GLBuffer::create();
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.get());
+	glBufferData(GL_ARRAY_BUFFER, sizeof(tileVertices), tileVertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+
+	normalBuffer = GLBuffer::create();
+	glBindBuffer(GL_ARRAY_BUFFER, normalBuffer.get());
+	glBufferData(GL_ARRAY_BUFFER, sizeof(tileNormals), tileNormals, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+	// Instance position and size, pointed at the stream buffer every frame
+	glEnableVertexAttribArray(3);
+	glVertexAttribDivisor(3, 1);
+
+	indexBuffer = GLBuffer::create();
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.get());
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(tileIndices), tileIndices, GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+
+	program = GLProgram(LoadShadersFromFile(vertex_file_path, fragment_file_path));
+	if (!program)
+		std::cerr << "Failed to load tile shaders." << std::endl;
+
+	viewProjectionID = glGetUniformLocation(program.get(), "VP");
+	glUseProgram(program.get());
+	glUniform1i(glGetUniformLocation(program.get(), "texture1"), 0);
+	glUseProgram(0);
+
+	if (texture_file_path)
+		texture = LoadTexture(texture_file_path);
+}
+
+void TileRenderer::cleanup()
+{
+	vertexArray.reset();
+	vertexBuffer.reset();
+	normalBuffer.reset();
+	indexBuffer.reset();
+	program.reset();
+	texture = 0;
+}
+
+void TileRenderer::setCornerHeights(const float heights[4])
+{
+	float vertices[20];
+	for (int i = 0; i < 20; ++i)
+		vertices[i] = tileVertices[i];
+	for (int corner = 0; corner < 4; ++corner)
+		vertices[corner * 5 + 1] = heights[corner];
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.get());
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TileRenderer::render(const std::vector<Tile> &tiles, StreamBuffer &stream, const glm::mat4 &viewProjection)
+{
+	if (tiles.empty())
+		return;
+
+	instances.clear();
+	for (const Tile &tile : tiles)
+		instances.push_back({ tile.position, tile.scale });
+
+	glUseProgram(program.get());
+	glUniformMatrix4fv(viewProjectionID, 1, GL_FALSE, &viewProjection[0][0]);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glBindVertexArray(vertexArray.get());
+	glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+
+	// Draw as many tiles as the region still holds instead of none, a full region refuses the
+	// next write, which ends the loop
+	size_t first = 0;
+	while (first < instances.size()) {
+		size_t count = std::min(instances.size() - first, std::max<size_t>(stream.available() / sizeof(Instance), 1));
+		GLintptr offset = stream.write(&instances[first], count * sizeof(Instance));
+		if (offset < 0)
+			break;
+
+		// The records move around the ring, so the instance attribute is re-pointed for each write
+		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offset);
+		glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, (GLsizei)count);
+		first += count;
+	}
+
+	glBindVertexArray(0);
+}
@@ -0,0 +1,56 @@
+#ifndef _TILERENDERER_H_
+#define _TILERENDERER_H_
+
+#include "glresource.h"
+#include "streambuffer.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// A square ground tile, centred on position, size units along each side
+struct Tile {
+	glm::vec3 position;
+	float scale;
+
+	Tile(glm::vec3 pos, float size) : position(pos), scale(size) {}
+};
+
+// Draws tiles with one instanced call. The tiles share a unit quad in the xz plane, and each
+// frame their positions and sizes are written to a StreamBuffer, one vec4 per tile.
+// The scene's shaders read vertex attributes 0 position, 1 uv, 2 normal and 3 the tile's
+// position in xyz and size in w. The texture is bound to unit 0 as texture1, and a VP uniform,
+// if the program has one, receives the view-projection matrix.
+class TileRenderer {
+public:
+	// Needs the GL context. The program is compiled once here, set its other uniforms through
+	// programID(). Without a texture nothing is bound to unit 0.
+	void initialize(const char *vertex_file_path, const char *fragment_file_path, const char *texture_file_path = NULL);
+	void cleanup();
+
+	// Raise the quad's corners -x-z, +x-z, +x+z and -x+z, in tile sizes. Every tile gets the same shape.
+	void setCornerHeights(const float heights[4]);
+
+	// The records go to this frame's region, so call between stream.beginFrame() and endFrame().
+	// Tiles past what the region still holds are left undrawn and counted as an overflow.
+	void render(const std::vector<Tile> &tiles, StreamBuffer &stream, const glm::mat4 &viewProjection);
+
+	GLuint programID() const { return program.get(); }
+
+private:
+	struct Instance {
+		glm::vec3 position;
+		float scale;
+	};
+
+	GLProgram program;
+	GLVertexArray vertexArray;
+	GLBuffer vertexBuffer;
+	GLBuffer normalBuffer;
+	GLBuffer indexBuffer;
+	GLuint texture = 0;				// Owned by the texture loader
+	GLint viewProjectionID = -1;
+
+	std::vector<Instance> instances;	// Staging for this frame's stream write
+};
+
+#endif